@@ -1,6 +1,14 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <queue>
+#include <thread>
+#include <atomic>
+#include <chrono>
 
 using namespace std;
 
@@ -13,93 +21,2816 @@ struct Point {
 };
 
 /**
- * @brief Calculate the distance between a point and a line segment.
+ * @brief Compute the sum of two doubles as a non-overlapping pair (x + y == a + b exactly).
+ */
+void twoSum(double a, double b, double& x, double& y) {
+    x = a + b;
+    double bVirtual = x - a;
+    double aVirtual = x - bVirtual;
+    y = (a - aVirtual) + (b - bVirtual);
+}
+
+/**
+ * @brief Compute the product of two doubles as a non-overlapping pair (x + y == a * b exactly).
+ */
+void twoProduct(double a, double b, double& x, double& y) {
+    x = a * b;
+    y = fma(a, b, -x);
+}
+
+/**
+ * @brief Add two floating-point expansions exactly.
+ *
+ * @param e The first expansion (components in increasing magnitude).
+ * @param f The second expansion (components in increasing magnitude).
+ * @return The exact sum as an expansion in increasing magnitude.
+ */
+vector<double> expansionSum(const vector<double>& e, const vector<double>& f) {
+    vector<double> h = e;
+    for (double b : f) {
+        vector<double> grown;
+        double q = b;
+        for (double component : h) {
+            double sum, error;
+            twoSum(q, component, sum, error);
+            if (error != 0.0) {
+                grown.push_back(error);
+            }
+            q = sum;
+        }
+        grown.push_back(q);
+        h = grown;
+    }
+    return h;
+}
+
+/**
+ * @brief Return the value of an expansion, whose sign is always the sign of the exact value.
+ */
+double expansionEstimate(const vector<double>& e) {
+    double sum = 0.0;
+    for (double component : e) {
+        sum += component;
+    }
+    return sum;
+}
+
+/**
+ * @brief Robust orientation predicate.
+ *
+ * Uses a fast floating-point filter and falls back to exact expansion arithmetic
+ * when the result is too close to zero to be trusted.
+ *
+ * @param a The first point.
+ * @param b The second point.
+ * @param c The point being classified.
+ * @return A positive value if a, b, c turn counter-clockwise, negative if clockwise, zero if collinear.
+ */
+double orient2d(Point a, Point b, Point c) {
+    double detLeft = (a.x - c.x) * (b.y - c.y);
+    double detRight = (a.y - c.y) * (b.x - c.x);
+    double det = detLeft - detRight;
+    double errorBound = 3.3306690738754716e-16 * (abs(detLeft) + abs(detRight));
+    if (det >= errorBound || -det >= errorBound) {
+        return det;
+    }
+
+    // Exact fallback: ax*by - ax*cy - ay*bx + ay*cx + bx*cy - by*cx.
+    const double terms[6][2] = {
+        {a.x, b.y}, {-a.x, c.y}, {-a.y, b.x}, {a.y, c.x}, {b.x, c.y}, {-b.y, c.x}};
+    vector<double> exact;
+    for (const auto& term : terms) {
+        double product, error;
+        twoProduct(term[0], term[1], product, error);
+        exact = expansionSum(exact, {error, product});
+    }
+    return expansionEstimate(exact);
+}
+
+/**
+ * @brief Multiply an expansion by a double exactly.
+ */
+vector<double> scaleExpansion(const vector<double>& e, double b) {
+    vector<double> h;
+    for (double component : e) {
+        double product, error;
+        twoProduct(component, b, product, error);
+        h = expansionSum(h, {error, product});
+    }
+    return h;
+}
+
+/**
+ * @brief Multiply two expansions exactly.
+ */
+vector<double> expansionProduct(const vector<double>& e, const vector<double>& f) {
+    vector<double> h;
+    for (double component : f) {
+        h = expansionSum(h, scaleExpansion(e, component));
+    }
+    return h;
+}
+
+/**
+ * @brief Exact difference of two doubles as an expansion.
+ */
+vector<double> expansionDiff(double a, double b) {
+    double x, y;
+    twoSum(a, -b, x, y);
+    return {y, x};
+}
+
+/**
+ * @brief Robust in-circle predicate.
+ *
+ * Uses a fast floating-point filter and falls back to exact expansion arithmetic
+ * when the result is too close to zero to be trusted.
+ *
+ * @param a The first point of a counter-clockwise triangle.
+ * @param b The second point of the triangle.
+ * @param c The third point of the triangle.
+ * @param d The point being classified.
+ * @return A positive value if d lies inside the circumcircle of a, b, c, negative if outside, zero if on it.
+ */
+double incircle(Point a, Point b, Point c, Point d) {
+    double adx = a.x - d.x, ady = a.y - d.y;
+    double bdx = b.x - d.x, bdy = b.y - d.y;
+    double cdx = c.x - d.x, cdy = c.y - d.y;
+
+    double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+    double cdxady = cdx * ady, adxcdy = adx * cdy;
+    double adxbdy = adx * bdy, bdxady = bdx * ady;
+    double alift = adx * adx + ady * ady;
+    double blift = bdx * bdx + bdy * bdy;
+    double clift = cdx * cdx + cdy * cdy;
+
+    double det = alift * (bdxcdy - cdxbdy) + blift * (cdxady - adxcdy) + clift * (adxbdy - bdxady);
+    double permanent = (abs(bdxcdy) + abs(cdxbdy)) * alift + (abs(cdxady) + abs(adxcdy)) * blift +
+                       (abs(adxbdy) + abs(bdxady)) * clift;
+    double errorBound = 1.1102230246251577e-15 * permanent;
+    if (det > errorBound || -det > errorBound) {
+        return det;
+    }
+
+    // Exact fallback on the same formula, with every difference kept as an expansion.
+    vector<double> eadx = expansionDiff(a.x, d.x), eady = expansionDiff(a.y, d.y);
+    vector<double> ebdx = expansionDiff(b.x, d.x), ebdy = expansionDiff(b.y, d.y);
+    vector<double> ecdx = expansionDiff(c.x, d.x), ecdy = expansionDiff(c.y, d.y);
+
+    auto cross2 = [](const vector<double>& px, const vector<double>& py, const vector<double>& qx, const vector<double>& qy) {
+        return expansionSum(expansionProduct(px, qy), scaleExpansion(expansionProduct(qx, py), -1.0));
+    };
+    auto lift = [](const vector<double>& px, const vector<double>& py) {
+        return expansionSum(expansionProduct(px, px), expansionProduct(py, py));
+    };
+
+    vector<double> exact = expansionProduct(lift(eadx, eady), cross2(ebdx, ebdy, ecdx, ecdy));
+    exact = expansionSum(exact, expansionProduct(lift(ebdx, ebdy), cross2(ecdx, ecdy, eadx, eady)));
+    exact = expansionSum(exact, expansionProduct(lift(ecdx, ecdy), cross2(eadx, eady, ebdx, ebdy)));
+    return expansionEstimate(exact);
+}
+
+/**
+ * @brief Robust cross or dot product of the directions b - a and q - p.
+ *
+ * Same filter as orient2d (the four differences are rounded independently, as there), with an
+ * exact expansion fallback, so the sign is always right.
+ *
+ * @param dot True for (b - a) . (q - p), false for (b - a) x (q - p).
+ */
+double directionProduct(Point a, Point b, Point p, Point q, bool dot) {
+    double ux = b.x - a.x, uy = b.y - a.y, vx = q.x - p.x, vy = q.y - p.y;
+    double detLeft = dot ? ux * vx : ux * vy;
+    double detRight = dot ? -uy * vy : uy * vx;
+    double det = detLeft - detRight;
+    double errorBound = 3.3306690738754716e-16 * (abs(detLeft) + abs(detRight));
+    if (det >= errorBound || -det >= errorBound) {
+        return det;
+    }
+
+    vector<double> eux = expansionDiff(b.x, a.x), euy = expansionDiff(b.y, a.y);
+    vector<double> evx = expansionDiff(q.x, p.x), evy = expansionDiff(q.y, p.y);
+    vector<double> exact = dot ? expansionSum(expansionProduct(eux, evx), expansionProduct(euy, evy))
+                               : expansionSum(expansionProduct(eux, evy), scaleExpansion(expansionProduct(euy, evx), -1.0));
+    return expansionEstimate(exact);
+}
+
+/**
+ * @brief Find the point with the maximum distance from a line segment.
+ *
+ * Distances are compared exactly. Of several equally distant points the one farthest along
+ * a -> b wins, which is a hull vertex; the others lie on its edge and must not be chosen.
+ *
+ * @param points The set of points to search.
+ * @param candidates Indices of the points to consider, all strictly to the right of a -> b.
+ * @param a Index of the first point of the line segment.
+ * @param b Index of the second point of the line segment.
+ * @return The index of the point in the points vector with the maximum distance from the line segment.
+ */
+int findMaxDistancePoint(const vector<Point>& points, const vector<int>& candidates, int a, int b) {
+    int maxPointIndex = candidates[0];
+
+    for (int i : candidates) {
+        // Candidates are right of a -> b, so a farther one has a more negative cross product.
+        double farther = directionProduct(points[a], points[b], points[maxPointIndex], points[i], false);
+        if (farther < 0 || (farther == 0 && directionProduct(points[a], points[b], points[maxPointIndex], points[i], true) > 0)) {
+            maxPointIndex = i;
+        }
+    }
+
+    return maxPointIndex;
+}
+
+/**
+ * @brief Recursive QuickHull step: emit the hull vertices strictly between a and b.
+ *
+ * Points on the new edges (zero area with them) are dropped, so no collinear vertex is emitted.
+ *
+ * @param points The set of points.
+ * @param candidates Indices of the points lying strictly to the right of the directed line a -> b.
+ * @param a Index of the chain start.
+ * @param b Index of the chain end.
+ * @param hull The vector receiving hull indices in counter-clockwise order.
+ */
+void quickHullChain(const vector<Point>& points, const vector<int>& candidates, int a, int b, vector<int>& hull) {
+    if (candidates.empty()) {
+        return;
+    }
+
+    int c = findMaxDistancePoint(points, candidates, a, b);
+
+    vector<int> rightOfAC, rightOfCB;
+    for (int i : candidates) {
+        if (orient2d(points[a], points[c], points[i]) < 0) {
+            rightOfAC.push_back(i);
+        } else if (orient2d(points[c], points[b], points[i]) < 0) {
+            rightOfCB.push_back(i);
+        }
+    }
+
+    quickHullChain(points, rightOfAC, a, c, hull);
+    hull.push_back(c);
+    quickHullChain(points, rightOfCB, c, b, hull);
+}
+
+/**
+ * @brief QuickHull over a subset of points, returning indices.
+ *
+ * @param points The set of points.
+ * @param candidates Indices of the points to take the hull of.
+ * @param hull The vector receiving hull indices in counter-clockwise order, starting at the leftmost point.
+ */
+void quickHullIndices(const vector<Point>& points, const vector<int>& candidates, vector<int>& hull) {
+    if (candidates.empty()) {
+        return;
+    }
+
+    // The leftmost and rightmost points (ties broken by y) are always on the hull.
+    int left = candidates[0], right = candidates[0];
+    for (int i : candidates) {
+        if (points[i].x < points[left].x || (points[i].x == points[left].x && points[i].y < points[left].y)) {
+            left = i;
+        }
+        if (points[i].x > points[right].x || (points[i].x == points[right].x && points[i].y > points[right].y)) {
+            right = i;
+        }
+    }
+
+    hull.push_back(left);
+    if (points[left].x == points[right].x && points[left].y == points[right].y) {
+        return; // All points coincide.
+    }
+
+    vector<int> below, above;
+    for (int i : candidates) {
+        double side = orient2d(points[left], points[right], points[i]);
+        if (side < 0) {
+            below.push_back(i);
+        } else if (side > 0) {
+            above.push_back(i);
+        }
+    }
+
+    quickHullChain(points, below, left, right, hull);
+    hull.push_back(right);
+    quickHullChain(points, above, right, left, hull);
+}
+
+/**
+ * @brief QuickHull algorithm to find the convex hull of a set of points.
+ *
+ * @param points The set of points.
+ * @param left The index of the first point of the range to process.
+ * @param right The index of the last point of the range to process.
+ * @param convexHull The vector to store the points of the convex hull, in counter-clockwise order.
+ */
+void quickHull(vector<Point>& points, int left, int right, vector<Point>& convexHull) {
+    if (points.empty() || left > right) {
+        return; // Base case: No points, nothing to do.
+    }
+
+    vector<int> candidates;
+    for (int i = left; i <= right; i++) {
+        candidates.push_back(i);
+    }
+
+    vector<int> hull;
+    quickHullIndices(points, candidates, hull);
+    for (int i : hull) {
+        convexHull.push_back(points[i]);
+    }
+}
+
+/**
+ * @brief Check that a hull is strictly convex, counter-clockwise and contains every point, exactly.
+ */
+bool isStrictHull(const vector<Point>& points, const vector<Point>& hull) {
+    int m = hull.size();
+    if (m < 3) {
+        return true;
+    }
+    for (int i = 0; i < m; i++) {
+        if (!(orient2d(hull[i], hull[(i + 1) % m], hull[(i + 2) % m]) > 0)) {
+            return false;
+        }
+        for (const Point& p : points) {
+            if (orient2d(hull[i], hull[(i + 1) % m], p) < 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Self-check of the planar QuickHull on degenerate inputs.
+ *
+ * Fixed cases with collinear and duplicate points are compared with their expected vertex
+ * lists. Then random point sets on a few lines and a small grid, where most points are
+ * collinear with a hull edge, must give strictly convex hulls containing every point.
+ *
+ * @param rounds The number of random point sets to check.
+ * @return True if every check passed.
+ */
+bool checkQuickHull(int rounds) {
+    struct Case {
+        vector<Point> points, hull;
+    };
+    const Case cases[] = {
+        {{{0, 0}, {4, 0}, {2, 1}, {1, 1}, {3, 1}}, {{0, 0}, {4, 0}, {3, 1}, {1, 1}}},
+        {{{0, 0}, {1, 0}, {2, 0}, {2, 1}, {2, 2}, {1, 2}, {0, 2}, {0, 1}, {1, 1}}, {{0, 0}, {2, 0}, {2, 2}, {0, 2}}},
+        {{{1, 1}, {0, 0}, {1, 1}, {2, 0}, {0, 0}, {1, 3}, {1, 3}}, {{0, 0}, {2, 0}, {1, 3}}},
+        {{{0, 0}, {1, 1}, {2, 2}, {3, 3}}, {{0, 0}, {3, 3}}},
+        {{{5, 5}, {5, 5}}, {{5, 5}}},
+    };
+    for (const Case& c : cases) {
+        vector<Point> points = c.points, hull;
+        quickHull(points, 0, (int)points.size() - 1, hull);
+        bool same = equal(hull.begin(), hull.end(), c.hull.begin(), c.hull.end(),
+                          [](Point a, Point b) { return a.x == b.x && a.y == b.y; });
+        if (!same) {
+            cout << "Hull of " << points.size() << " points starting at (" << points[0].x << ", " << points[0].y
+                 << ") has " << hull.size() << " vertices, expected " << c.hull.size() << endl;
+            return false;
+        }
+    }
+
+    srand(2024);
+    for (int round = 0; round < rounds; round++) {
+        vector<Point> points;
+        int n = 3 + rand() % 300;
+        for (int i = 0; i < n; i++) {
+            if (round % 2 == 0) {
+                points.push_back({(double)(rand() % 8), (double)(rand() % 8)});
+            } else {
+                // Points on lines through the origin with inexact slopes.
+                double t = rand() / (double)RAND_MAX, slope = 0.1 * (1 + rand() % 3);
+                points.push_back({t, slope * t});
+            }
+        }
+        vector<Point> hull;
+        quickHull(points, 0, n - 1, hull);
+        if (!isStrictHull(points, hull)) {
+            cout << "Round " << round << ": hull of " << n << " points is not strictly convex" << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Signed area of a polygon, positive for counter-clockwise vertex order.
+ */
+double polygonArea(const vector<Point>& polygon) {
+    double twice = 0.0;
+    for (size_t i = 0, n = polygon.size(); i < n; i++) {
+        Point a = polygon[i], b = polygon[(i + 1) % n];
+        twice += a.x * b.y - a.y * b.x;
+    }
+    return twice / 2;
+}
+
+/**
+ * @brief Reduce a counter-clockwise convex hull to at most k vertices, adding or losing little area.
+ *
+ * Greedy with a priority queue, O(h log h). An inscribed simplification keeps a subset of the
+ * vertices, repeatedly dropping the vertex whose triangle with its neighbours is smallest. An
+ * enclosing one repeatedly removes the edge whose neighbouring edges, extended until they meet,
+ * add the smallest triangle, so the result contains the hull (up to rounding of the new
+ * corners). An edge can only be removed when its neighbours converge beyond it; every hull of
+ * five or more vertices has such an edge, so an enclosing simplification only stops early, at
+ * four vertices, on a parallelogram.
+ *
+ * @param hull The hull vertices in counter-clockwise order, without collinear vertices.
+ * @param k The vertex budget, at least 3.
+ * @param enclosing True for a polygon containing the hull, false for one inside it.
+ * @param areaChange Receives the area added (enclosing) or lost (inscribed), if not null.
+ * @return The simplified polygon in counter-clockwise order.
+ */
+vector<Point> simplifyHull(const vector<Point>& hull, int k, bool enclosing, double* areaChange = nullptr) {
+    int n = hull.size();
+    if (areaChange) {
+        *areaChange = 0.0;
+    }
+    if (n <= k || k < 3) {
+        return hull;
+    }
+
+    vector<Point> position = hull;
+    vector<int> prev(n), next(n), version(n, 0);
+    vector<bool> alive(n, true);
+    for (int i = 0; i < n; i++) {
+        prev[i] = (i + n - 1) % n;
+        next[i] = (i + 1) % n;
+    }
+
+    // Cost of removing vertex i (inscribed) or the edge from i to next[i] (enclosing).
+    auto cost = [&](int i, Point* corner) {
+        Point a = position[prev[i]], b = position[i], c = position[next[i]];
+        if (!enclosing) {
+            return abs(orient2d(a, b, c)) / 2;
+        }
+        Point d = position[next[next[i]]];
+        double d1x = b.x - a.x, d1y = b.y - a.y, d2x = d.x - c.x, d2y = d.y - c.y;
+        double turn = d1x * d2y - d1y * d2x;
+        if (!(turn > 0)) {
+            return (double)INFINITY; // The extended edges do not meet beyond this one.
+        }
+        double t = ((c.x - b.x) * d2y - (c.y - b.y) * d2x) / turn;
+        Point p = {b.x + t * d1x, b.y + t * d1y};
+        if (corner) {
+            *corner = p;
+        }
+        return abs(orient2d(b, p, c)) / 2;
+    };
+
+    typedef pair<double, pair<int, int>> Entry; // cost, vertex, version
+    priority_queue<Entry, vector<Entry>, greater<Entry>> queue;
+    for (int i = 0; i < n; i++) {
+        queue.push({cost(i, nullptr), {i, 0}});
+    }
+
+    int count = n;
+    while (count > k && !queue.empty()) {
+        Entry top = queue.top();
+        queue.pop();
+        int i = top.second.first;
+        if (!alive[i] || top.second.second != version[i]) {
+            continue; // Stale entry, superseded after a neighbour changed.
+        }
+        if (top.first == INFINITY) {
+            break;
+        }
+
+        int removed = i;
+        if (enclosing) {
+            // The new corner replaces i, and next[i] goes.
+            cost(i, &position[i]);
+            removed = next[i];
+        }
+        alive[removed] = false;
+        next[prev[removed]] = next[removed];
+        prev[next[removed]] = prev[removed];
+        count--;
+        if (areaChange) {
+            *areaChange += top.first;
+        }
+
+        int start = enclosing ? i : prev[removed];
+        for (int j : {prev[start], start, next[start]}) {
+            version[j]++;
+            queue.push({cost(j, nullptr), {j, version[j]}});
+        }
+    }
+
+    // Walk the survivors from the first one, keeping the original starting vertex when it survived.
+    int first = 0;
+    while (!alive[first]) {
+        first++;
+    }
+    vector<Point> result;
+    int i = first;
+    do {
+        result.push_back(position[i]);
+        i = next[i];
+    } while (i != first);
+    return result;
+}
+
+/**
+ * @struct HullSet
+ * @brief Many polygons in compressed sparse row form.
+ *
+ * Polygon h has the vertices vertices[offsets[h]] up to vertices[offsets[h + 1]] (exclusive);
+ * offsets has one more entry than there are polygons and starts at 0.
+ */
+struct HullSet {
+    vector<int> offsets = {0};
+    vector<Point> vertices;
+
+    int size() const { return offsets.size() - 1; }
+
+    void add(const vector<Point>& polygon) {
+        vertices.insert(vertices.end(), polygon.begin(), polygon.end());
+        offsets.push_back(vertices.size());
+    }
+
+    vector<Point> polygon(int h) const {
+        return vector<Point>(vertices.begin() + offsets[h], vertices.begin() + offsets[h + 1]);
+    }
+};
+
+/**
+ * @brief Simplify every hull of a set, in parallel across hulls.
+ *
+ * @param hulls The hulls, each in counter-clockwise order.
+ * @param k The vertex budget of every hull.
+ * @param enclosing True for enclosing simplifications, false for inscribed ones.
+ * @param threads The number of worker threads.
+ * @param areaChanges Receives the area change of every hull, if not null.
+ * @return The simplified hulls, in the same order.
+ */
+HullSet simplifyHullSet(const HullSet& hulls, int k, bool enclosing, int threads, vector<double>* areaChanges = nullptr) {
+    int count = hulls.size();
+    vector<vector<Point>> simplified(count);
+    vector<double> changes(count);
+    atomic<int> nextHull(0);
+
+    // Hulls are handed out in small chunks, as their sizes vary.
+    const int chunk = 64;
+    auto work = [&]() {
+        for (int begin; (begin = nextHull.fetch_add(chunk)) < count;) {
+            for (int h = begin; h < min(begin + chunk, count); h++) {
+                simplified[h] = simplifyHull(hulls.polygon(h), k, enclosing, &changes[h]);
+            }
+        }
+    };
+    vector<thread> workers;
+    for (int t = 1; t < threads; t++) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (thread& worker : workers) {
+        worker.join();
+    }
+
+    HullSet result;
+    result.offsets.reserve(count + 1);
+    for (const vector<Point>& polygon : simplified) {
+        result.add(polygon);
+    }
+    if (areaChanges) {
+        *areaChanges = changes;
+    }
+    return result;
+}
+
+/**
+ * @brief Self-check and benchmark of hull simplification on random point sets.
+ *
+ * Checks that every simplified polygon is convex and within budget, that inscribed ones keep
+ * a subset of the hull vertices, that enclosing ones contain the hull, and that the reported
+ * area change matches the areas. Then times the batch mode on a large hull set.
+ *
+ * @param rounds The number of random point sets to check.
+ * @param threads The number of threads of the batch benchmark.
+ * @return True if every check passed.
+ */
+bool checkSimplify(int rounds, int threads) {
+    srand(12345);
+    auto randomHull = [](int n) {
+        vector<Point> points;
+        for (int i = 0; i < n; i++) {
+            // Points in a disc give hulls with many vertices.
+            double r = sqrt(rand() / (double)RAND_MAX), angle = 2 * M_PI * rand() / (double)RAND_MAX;
+            points.push_back({r * cos(angle), r * sin(angle)});
+        }
+        vector<Point> hull;
+        quickHull(points, 0, n - 1, hull);
+        return hull;
+    };
+
+    for (int round = 0; round < rounds; round++) {
+        vector<Point> hull = randomHull(3 + rand() % 2000);
+        int k = 3 + rand() % 12;
+        for (bool enclosing : {false, true}) {
+            double change;
+            vector<Point> simple = simplifyHull(hull, k, enclosing, &change);
+            int m = simple.size();
+            bool ok = m <= max(k, enclosing ? 4 : 3) || (int)hull.size() == m;
+            for (int i = 0; i < m && ok; i++) {
+                ok = orient2d(simple[i], simple[(i + 1) % m], simple[(i + 2) % m]) > 0;
+            }
+            for (const Point& p : (enclosing ? hull : simple)) {
+                const vector<Point>& outer = enclosing ? simple : hull;
+                bool inside = false, onHull = false;
+                for (int i = 0; i < (int)outer.size(); i++) {
+                    Point a = outer[i], b = outer[(i + 1) % outer.size()];
+                    double scale = abs(b.x - a.x) + abs(b.y - a.y);
+                    inside = orient2d(a, b, p) >= -1e-12 * scale * scale;
+                    onHull = onHull || (p.x == a.x && p.y == a.y);
+                    if (!inside) {
+                        break;
+                    }
+                }
+                ok = ok && (enclosing ? inside : onHull);
+            }
+            double expected = abs(polygonArea(simple) - polygonArea(hull));
+            ok = ok && abs(change - expected) <= 1e-9 * max(1.0, polygonArea(hull));
+            if (!ok) {
+                cout << "Round " << round << ": " << (enclosing ? "enclosing" : "inscribed") << " simplification of "
+                     << hull.size() << " vertices to " << k << " failed" << endl;
+                return false;
+            }
+        }
+    }
+
+    HullSet hulls;
+    for (int h = 0; h < 20000; h++) {
+        hulls.add(randomHull(50 + rand() % 400));
+    }
+    for (bool enclosing : {false, true}) {
+        auto start = chrono::steady_clock::now();
+        HullSet serial = simplifyHullSet(hulls, 8, enclosing, 1);
+        auto middle = chrono::steady_clock::now();
+        HullSet parallel = simplifyHullSet(hulls, 8, enclosing, threads);
+        auto end = chrono::steady_clock::now();
+        bool same = serial.offsets == parallel.offsets &&
+                    equal(serial.vertices.begin(), serial.vertices.end(), parallel.vertices.begin(),
+                          [](Point a, Point b) { return a.x == b.x && a.y == b.y; });
+        cout << (enclosing ? "Enclosing" : "Inscribed") << ": " << hulls.size() << " hulls, " << hulls.vertices.size()
+             << " vertices to " << serial.vertices.size() << ", 1 thread "
+             << chrono::duration<double, milli>(middle - start).count() << " ms, " << threads << " threads "
+             << chrono::duration<double, milli>(end - middle).count() << " ms" << endl;
+        if (!same) {
+            cout << "Parallel batch differs from the serial one" << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @struct Box
+ * @brief An axis-aligned bounding box.
+ */
+struct Box {
+    double minX, minY, maxX, maxY;
+
+    bool contains(Point p) const { return p.x >= minX && p.x <= maxX && p.y >= minY && p.y <= maxY; }
+};
+
+/**
+ * @brief Bounding box of a polygon.
+ */
+Box boundingBox(const Point* begin, const Point* end) {
+    Box box = {INFINITY, INFINITY, -INFINITY, -INFINITY};
+    for (const Point* p = begin; p != end; p++) {
+        box.minX = min(box.minX, p->x);
+        box.minY = min(box.minY, p->y);
+        box.maxX = max(box.maxX, p->x);
+        box.maxY = max(box.maxY, p->y);
+    }
+    return box;
+}
+
+/**
+ * @brief Point in a counter-clockwise convex polygon, by binary search for its wedge around the first vertex.
+ *
+ * @param polygon The first vertex of the polygon.
+ * @param m The number of vertices, at least 3.
+ * @param p The point.
+ * @return True if p lies inside the polygon or on its boundary.
+ */
+bool convexContains(const Point* polygon, int m, Point p) {
+    if (orient2d(polygon[0], polygon[1], p) < 0 || orient2d(polygon[0], polygon[m - 1], p) > 0) {
+        return false;
+    }
+    // The wedge between the rays to polygon[lo] and polygon[lo + 1] contains p.
+    int lo = 1, hi = m - 1;
+    while (hi - lo > 1) {
+        int mid = (lo + hi) / 2;
+        if (orient2d(polygon[0], polygon[mid], p) >= 0) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return orient2d(polygon[lo], polygon[lo + 1], p) >= 0;
+}
+
+/**
+ * @brief Position of a cell along a Hilbert curve filling a 65536 x 65536 grid.
+ */
+uint64_t hilbertKey(uint32_t x, uint32_t y) {
+    uint64_t key = 0;
+    for (uint32_t s = 1u << 15; s > 0; s >>= 1) {
+        uint32_t rx = (x & s) > 0, ry = (y & s) > 0;
+        key += (uint64_t)s * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            swap(x, y);
+        }
+    }
+    return key;
+}
+
+/**
+ * @class HullIndex
+ * @brief Which-hull-contains-this-point index over a set of convex hulls.
+ *
+ * A packed R-tree over the hull bounding boxes, bulk loaded with Sort-Tile-Recursive: each
+ * level is sorted into vertical slices by box centre x, each slice by centre y, and runs of
+ * fanout entries become the nodes of the level above. Leaves are tested with convexContains.
+ * An empty set gives an empty index, on which every point is outside. The hulls must stay
+ * alive and unchanged while the index is used.
+ */
+class HullIndex {
+public:
+    /**
+     * @brief Build the index, sorting the slices of each level in parallel.
+     * @param hulls The hulls, each in counter-clockwise order.
+     * @param threads The number of worker threads.
+     */
+    HullIndex(const HullSet& hulls, int threads);
+
+    /**
+     * @brief Find the lowest-numbered hull containing a point, boundary included.
+     * @param p The point.
+     * @return The hull index, or -1 if no hull contains the point.
+     */
+    int locate(Point p) const;
+
+    /**
+     * @brief Locate many points, walking them in Hilbert order so that neighbouring queries share tree paths.
+     * @param queries The points.
+     * @param threads The number of worker threads.
+     * @param sorted False to walk the queries in their given order instead.
+     * @return The result of locate for every query, in query order.
+     */
+    vector<int> locateBatch(const vector<Point>& queries, int threads, bool sorted = true) const;
+
+private:
+    static const int fanout = 16;
+
+    // An entry of a level: a hull (count == 0, first is the hull) or a node (children first..first + count - 1).
+    struct Entry {
+        Box box;
+        int first, count;
+    };
+
+    const HullSet& hulls;
+    vector<vector<Entry>> levels; // levels[0] holds the hulls, levels.back() the root; empty without hulls
+};
+
+/**
+ * @brief Run work(begin, end) over [0, count) in chunks on a number of threads.
+ */
+template <typename Work>
+void parallelChunks(int count, int chunk, int threads, Work work) {
+    atomic<int> next(0);
+    auto run = [&]() {
+        for (int begin; (begin = next.fetch_add(chunk)) < count;) {
+            work(begin, min(begin + chunk, count));
+        }
+    };
+    vector<thread> workers;
+    for (int t = 1; t < threads; t++) {
+        workers.emplace_back(run);
+    }
+    run();
+    for (thread& worker : workers) {
+        worker.join();
+    }
+}
+
+HullIndex::HullIndex(const HullSet& hulls, int threads) : hulls(hulls) {
+    int count = hulls.size();
+    if (count == 0) {
+        return;
+    }
+    vector<Entry> level(count);
+    parallelChunks(count, 4096, threads, [&](int begin, int end) {
+        for (int h = begin; h < end; h++) {
+            const Point* polygon = hulls.vertices.data() + hulls.offsets[h];
+            level[h] = {boundingBox(polygon, polygon + (hulls.offsets[h + 1] - hulls.offsets[h])), h, 0};
+        }
+    });
+
+    auto centreX = [](const Entry& a, const Entry& b) { return a.box.minX + a.box.maxX < b.box.minX + b.box.maxX; };
+    auto centreY = [](const Entry& a, const Entry& b) { return a.box.minY + a.box.maxY < b.box.minY + b.box.maxY; };
+    while (true) {
+        int n = level.size();
+        int nodes = (n + fanout - 1) / fanout;
+        int slices = (int)ceil(sqrt((double)nodes));
+        int sliceSize = ((nodes + slices - 1) / slices) * fanout;
+
+        sort(level.begin(), level.end(), centreX);
+        parallelChunks(slices, 1, threads, [&](int begin, int end) {
+            for (int s = begin; s < end; s++) {
+                int from = min(s * sliceSize, n), to = min(from + sliceSize, n);
+                sort(level.begin() + from, level.begin() + to, centreY);
+            }
+        });
+        levels.push_back(level);
+        if (n <= 1) {
+            break;
+        }
+
+        // Runs of fanout entries never straddle slices, as slice sizes are multiples of fanout.
+        vector<Entry> parents(nodes);
+        const vector<Entry>& children = levels.back();
+        for (int j = 0; j < nodes; j++) {
+            int first = j * fanout, last = min(first + fanout, n);
+            Box box = children[first].box;
+            for (int c = first + 1; c < last; c++) {
+                box.minX = min(box.minX, children[c].box.minX);
+                box.minY = min(box.minY, children[c].box.minY);
+                box.maxX = max(box.maxX, children[c].box.maxX);
+                box.maxY = max(box.maxY, children[c].box.maxY);
+            }
+            parents[j] = {box, first, last - first};
+        }
+        level = parents;
+    }
+}
+
+int HullIndex::locate(Point p) const {
+    if (levels.empty()) {
+        return -1;
+    }
+    int best = -1;
+    pair<int, int> stack[64 * fanout]; // (level, entry); depth is logarithmic, so this never fills
+    int top = 0;
+    stack[top++] = {(int)levels.size() - 1, 0};
+    while (top > 0) {
+        pair<int, int> item = stack[--top];
+        const Entry& entry = levels[item.first][item.second];
+        if (!entry.box.contains(p)) {
+            continue;
+        }
+        if (item.first > 0) {
+            for (int c = entry.first; c < entry.first + entry.count; c++) {
+                stack[top++] = {item.first - 1, c};
+            }
+            continue;
+        }
+        int h = entry.first, m = hulls.offsets[h + 1] - hulls.offsets[h];
+        if ((best == -1 || h < best) && m >= 3 && convexContains(hulls.vertices.data() + hulls.offsets[h], m, p)) {
+            best = h;
+        }
+    }
+    return best;
+}
+
+vector<int> HullIndex::locateBatch(const vector<Point>& queries, int threads, bool sorted) const {
+    int n = queries.size();
+    vector<int> order(n);
+    for (int q = 0; q < n; q++) {
+        order[q] = q;
+    }
+    if (sorted && !levels.empty()) {
+        Box world = levels.back()[0].box;
+        double sx = 65535 / max(world.maxX - world.minX, 1e-300), sy = 65535 / max(world.maxY - world.minY, 1e-300);
+        vector<uint64_t> keys(n);
+        parallelChunks(n, 65536, threads, [&](int begin, int end) {
+            for (int q = begin; q < end; q++) {
+                // Points outside the indexed area are clamped to its border cells.
+                double x = min(max((queries[q].x - world.minX) * sx, 0.0), 65535.0);
+                double y = min(max((queries[q].y - world.minY) * sy, 0.0), 65535.0);
+                keys[q] = hilbertKey((uint32_t)x, (uint32_t)y) << 32 | (uint32_t)q;
+            }
+        });
+        sort(keys.begin(), keys.end());
+        for (int q = 0; q < n; q++) {
+            order[q] = (int)(keys[q] & 0xffffffffu);
+        }
+    }
+
+    vector<int> result(n);
+    parallelChunks(n, 1024, threads, [&](int begin, int end) {
+        for (int q = begin; q < end; q++) {
+            result[order[q]] = locate(queries[order[q]]);
+        }
+    });
+    return result;
+}
+
+/**
+ * @brief Self-check and benchmark of the hull index on random scattered hulls.
+ *
+ * Compares HullIndex::locate against a linear scan on a sample of the queries, then times
+ * the batched queries in the given and in Hilbert order.
+ *
+ * @param hullCount The number of hulls.
+ * @param queryCount The number of query points.
+ * @param threads The number of threads.
+ * @return True if every checked query matched.
+ */
+bool checkHullIndex(int hullCount, int queryCount, int threads) {
+    srand(12345);
+    auto uniform = []() { return rand() / (double)RAND_MAX; };
+    HullSet hulls;
+    for (int h = 0; h < hullCount; h++) {
+        double cx = 1000 * uniform(), cy = 1000 * uniform(), r = 0.5 + 2 * uniform();
+        vector<Point> points, hull;
+        for (int i = 0, n = 8 + rand() % 32; i < n; i++) {
+            points.push_back({cx + r * (2 * uniform() - 1), cy + r * (2 * uniform() - 1)});
+        }
+        quickHull(points, 0, (int)points.size() - 1, hull);
+        hulls.add(hull);
+    }
+    vector<Point> queries(queryCount);
+    for (Point& q : queries) {
+        q = {1000 * uniform(), 1000 * uniform()};
+    }
+
+    auto start = chrono::steady_clock::now();
+    HullIndex index(hulls, threads);
+    auto built = chrono::steady_clock::now();
+    vector<int> given = index.locateBatch(queries, threads, false);
+    auto unsortedDone = chrono::steady_clock::now();
+    vector<int> hilbert = index.locateBatch(queries, threads);
+    auto sortedDone = chrono::steady_clock::now();
+
+    int located = 0;
+    for (int q = 0; q < queryCount; q++) {
+        located += hilbert[q] != -1;
+    }
+    auto ms = [](chrono::steady_clock::time_point a, chrono::steady_clock::time_point b) {
+        return chrono::duration<double, milli>(b - a).count();
+    };
+    cout << hullCount << " hulls, " << queryCount << " queries (" << located << " inside a hull), " << threads
+         << " threads" << endl;
+    cout << "Build " << ms(start, built) << " ms, queries in given order " << ms(built, unsortedDone)
+         << " ms, in Hilbert order " << ms(unsortedDone, sortedDone) << " ms" << endl;
+    if (given != hilbert) {
+        cout << "Query order changed the results" << endl;
+        return false;
+    }
+
+    for (int q = 0; q < min(queryCount, 1000); q++) {
+        int expected = -1;
+        for (int h = 0; h < hullCount && expected == -1; h++) {
+            const Point* polygon = hulls.vertices.data() + hulls.offsets[h];
+            int m = hulls.offsets[h + 1] - hulls.offsets[h];
+            if (m >= 3 && boundingBox(polygon, polygon + m).contains(queries[q]) && convexContains(polygon, m, queries[q])) {
+                expected = h;
+            }
+        }
+        if (hilbert[q] != expected) {
+            cout << "Query " << q << ": index found " << hilbert[q] << ", linear scan " << expected << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @struct HalfPlane
+ * @brief The half-plane a * x + b * y <= c.
+ */
+struct HalfPlane {
+    double a, b, c;
+};
+
+/**
+ * @brief Outcome of a half-plane intersection.
+ */
+enum class Feasibility {
+    Empty,    /**< No point satisfies every constraint strictly; segments and single points count as empty */
+    Bounded,  /**< A convex polygon */
+    Unbounded /**< An unbounded convex region, returned clipped to a box for display */
+};
+
+/**
+ * @brief Robust position of the intersection of the boundaries of p and q against the boundary of r.
+ *
+ * Evaluates the 3 x 3 determinant of the coefficients with a floating-point filter and an
+ * exact expansion fallback, the same scheme as orient2d.
+ *
+ * @return A negative value if the intersection point lies strictly inside r, positive if
+ *         strictly outside, zero if on its boundary, provided the normals of p and q turn
+ *         counter-clockwise (a * q.b - q.a * b > 0); the sign flips otherwise.
+ */
+double halfPlaneSide(HalfPlane p, HalfPlane q, HalfPlane r) {
+    double m1 = q.b * r.c - r.b * q.c, m2 = q.a * r.c - r.a * q.c, m3 = q.a * r.b - r.a * q.b;
+    double det = p.a * m1 - p.b * m2 + p.c * m3;
+    double permanent = abs(p.a) * (abs(q.b * r.c) + abs(r.b * q.c)) + abs(p.b) * (abs(q.a * r.c) + abs(r.a * q.c)) +
+                       abs(p.c) * (abs(q.a * r.b) + abs(r.a * q.b));
+    double errorBound = 7.7715611723761027e-16 * permanent;
+    if (det > errorBound || -det > errorBound) {
+        return -det;
+    }
+
+    // Exact fallback: the six products of the determinant, each of three doubles.
+    const double terms[6][3] = {{p.a, q.b, r.c}, {-p.a, r.b, q.c}, {-p.b, q.a, r.c},
+                                {p.b, r.a, q.c}, {p.c, q.a, r.b}, {-p.c, r.a, q.b}};
+    vector<double> exact;
+    for (const auto& term : terms) {
+        double product, error;
+        twoProduct(term[0], term[1], product, error);
+        exact = expansionSum(exact, scaleExpansion({error, product}, term[2]));
+    }
+    return -expansionEstimate(exact);
+}
+
+/**
+ * @brief Intersection point of the boundaries of two non-parallel half-planes, rounded.
+ */
+Point boundaryIntersection(HalfPlane p, HalfPlane q) {
+    double d = p.a * q.b - q.a * p.b;
+    return {(p.c * q.b - q.c * p.b) / d, (p.a * q.c - q.a * p.c) / d};
+}
+
+/**
+ * @brief Intersect half-planes in O(n log n) by angle sort and a deque.
+ *
+ * Boundaries are sorted by the angle of their direction (-b, a), which keeps the region on the
+ * left, and parallel ones with the same direction are reduced to the tightest. The region is
+ * unbounded exactly when two consecutive directions are half a turn or more apart, unless it
+ * is empty. It is clipped to the box |x|, |y| <= bound to produce a polygon; when nothing is
+ * left, emptiness is decided again against a box pushed to infinity, whose sides have c = M
+ * for a symbolic M. The determinant of halfPlaneSide is linear in the c column, so its sign
+ * is that of the M coefficient, or of the rest when that vanishes. All decisions use orient2d
+ * and halfPlaneSide, so they are exact; only the output vertices are rounded.
+ *
+ * @param planes The half-planes.
+ * @param polygon Receives the region (clipped if unbounded) in counter-clockwise order; for an
+ *        unbounded region lying entirely outside the box, nothing.
+ * @param bound Half-size of the clipping box of unbounded regions.
+ * @return Whether the region is empty, bounded or unbounded.
+ */
+Feasibility intersectHalfPlanes(const vector<HalfPlane>& planes, vector<Point>& polygon, double bound = 1e12) {
+    polygon.clear();
+    const Point origin = {0, 0};
+    auto direction = [](const HalfPlane& h) { return Point{-h.b, h.a}; };
+    auto upper = [](Point d) { return d.y > 0 || (d.y == 0 && d.x > 0); };
+    auto before = [&](const HalfPlane& p, const HalfPlane& q) {
+        Point dp = direction(p), dq = direction(q);
+        if (upper(dp) != upper(dq)) {
+            return upper(dp);
+        }
+        return orient2d(dp, dq, origin) > 0;
+    };
+    auto parallel = [&](const HalfPlane& p, const HalfPlane& q) {
+        return upper(direction(p)) == upper(direction(q)) && orient2d(direction(p), direction(q), origin) == 0;
+    };
+    auto sortAndReduce = [&](vector<HalfPlane>& sorted) {
+        sort(sorted.begin(), sorted.end(), before);
+        vector<HalfPlane> reduced;
+        reduced.reserve(sorted.size() + 4);
+        for (const HalfPlane& h : sorted) {
+            if (!reduced.empty() && parallel(reduced.back(), h)) {
+                // Same direction: h is tighter if c / |n| is smaller; compare through the larger normal component.
+                // A side of the box at infinity is looser than any finite boundary.
+                HalfPlane& g = reduced.back();
+                if (isinf(h.c) || isinf(g.c)) {
+                    g = isinf(g.c) ? h : g;
+                    continue;
+                }
+                bool useA = abs(g.a) >= abs(g.b);
+                double gn = useA ? g.a : g.b, hn = useA ? h.a : h.b;
+                double tighter = orient2d({h.c, hn}, {g.c, gn}, origin) * (gn > 0 ? 1 : -1);
+                if (tighter < 0) {
+                    g = h;
+                }
+                continue;
+            }
+            reduced.push_back(h);
+        }
+        return reduced;
+    };
+
+    vector<HalfPlane> lines;
+    lines.reserve(planes.size() + 4);
+    for (const HalfPlane& h : planes) {
+        if (h.a == 0 && h.b == 0) {
+            if (h.c < 0) {
+                return Feasibility::Empty;
+            }
+            continue; // 0 <= c holds everywhere
+        }
+        lines.push_back(h);
+    }
+    lines = sortAndReduce(lines);
+
+    // Side of r the boundary intersection of p and q is on, with infinite c standing for c = M.
+    auto side = [](HalfPlane p, HalfPlane q, HalfPlane r) {
+        if (!isinf(p.c) && !isinf(q.c) && !isinf(r.c)) {
+            return halfPlaneSide(p, q, r);
+        }
+        HalfPlane pm = p, qm = q, rm = r;
+        for (HalfPlane* h : {&pm, &qm, &rm}) {
+            h->c = isinf(h->c) ? 1 : 0;
+        }
+        double atInfinity = halfPlaneSide(pm, qm, rm);
+        if (atInfinity != 0) {
+            return atInfinity;
+        }
+        for (HalfPlane* h : {&p, &q, &r}) {
+            h->c = isinf(h->c) ? 0 : h->c;
+        }
+        return halfPlaneSide(p, q, r);
+    };
+
+    // A vertex of the deque is kept only while it lies strictly inside every later half-plane.
+    // Returns whether the region is non-empty, and its vertices if vertices is given.
+    auto intersectSorted = [&](const vector<HalfPlane>& sorted, vector<Point>* vertices) {
+        vector<HalfPlane> deque(sorted.size());
+        int front = 0, back = 0; // deque[front..back)
+        auto outside = [&](int i, int j, const HalfPlane& r) { return side(deque[i], deque[j], r) >= 0; };
+        for (const HalfPlane& h : sorted) {
+            while (back - front >= 2 && outside(back - 2, back - 1, h)) {
+                back--;
+            }
+            while (back - front >= 2 && outside(front, front + 1, h)) {
+                front++;
+            }
+            if (back - front >= 1 && orient2d(direction(deque[back - 1]), direction(h), origin) <= 0) {
+                return false; // Everything between two opposite boundaries was cut away.
+            }
+            deque[back++] = h;
+        }
+        while (back - front >= 3 && outside(back - 2, back - 1, deque[front])) {
+            back--;
+        }
+        while (back - front >= 3 && outside(front, front + 1, deque[back - 1])) {
+            front++;
+        }
+        if (back - front < 3 || orient2d(direction(deque[back - 1]), direction(deque[front]), origin) <= 0) {
+            return false;
+        }
+        for (int i = front; vertices != nullptr && i < back; i++) {
+            vertices->push_back(boundaryIntersection(deque[i], deque[i + 1 < back ? i + 1 : front]));
+        }
+        return true;
+    };
+
+    int m = lines.size();
+    bool bounded = m >= 3;
+    for (int i = 0; i < m && bounded; i++) {
+        bounded = orient2d(direction(lines[i]), direction(lines[(i + 1) % m]), origin) > 0;
+    }
+    if (bounded) {
+        return intersectSorted(lines, &polygon) ? Feasibility::Bounded : Feasibility::Empty;
+    }
+
+    auto withBox = [&](double size) {
+        vector<HalfPlane> boxed = lines;
+        for (HalfPlane box : {HalfPlane{1, 0, size}, HalfPlane{-1, 0, size}, HalfPlane{0, 1, size}, HalfPlane{0, -1, size}}) {
+            boxed.push_back(box);
+        }
+        return sortAndReduce(boxed);
+    };
+    // A non-empty clip already proves the region non-empty; only an empty one needs the box at infinity.
+    if (intersectSorted(withBox(bound), &polygon) || intersectSorted(withBox(INFINITY), nullptr)) {
+        return Feasibility::Unbounded;
+    }
+    return Feasibility::Empty;
+}
+
+/**
+ * @brief Intersect many small sets of half-planes, in parallel across sets.
+ *
+ * @param offsets Set s has the half-planes planes[offsets[s]] up to planes[offsets[s + 1]] (exclusive).
+ * @param planes The half-planes of every set.
+ * @param threads The number of worker threads.
+ * @param regions Receives the region of every set, empty for empty sets.
+ * @return The outcome of every set.
+ */
+vector<Feasibility> intersectHalfPlaneSets(const vector<int>& offsets, const vector<HalfPlane>& planes, int threads, HullSet& regions) {
+    int count = offsets.size() - 1;
+    vector<Feasibility> outcomes(count);
+    vector<vector<Point>> polygons(count);
+    parallelChunks(count, 256, threads, [&](int begin, int end) {
+        for (int s = begin; s < end; s++) {
+            vector<HalfPlane> set(planes.begin() + offsets[s], planes.begin() + offsets[s + 1]);
+            outcomes[s] = intersectHalfPlanes(set, polygons[s]);
+        }
+    });
+    regions = HullSet();
+    for (const vector<Point>& polygon : polygons) {
+        regions.add(polygon);
+    }
+    return outcomes;
+}
+
+/**
+ * @brief Feasibility of a set of half-planes by a generic dense simplex method, for comparison.
+ *
+ * Solves min t subject to a * x + b * y - t <= c, t >= 0 with free x and y split into
+ * non-negative parts, starting from the basis where t covers the most violated constraint,
+ * with Bland's rule against cycling.
+ *
+ * @return True if the optimal t is (numerically) zero.
+ */
+bool simplexFeasible(const HalfPlane* planes, int n) {
+    // Columns: x+, x-, y+, y-, t, one slack per row, right-hand side.
+    int columns = 5 + n + 1, rhs = columns - 1;
+    vector<double> tableau((n + 1) * columns, 0.0);
+    auto at = [&](int row, int column) -> double& { return tableau[row * columns + column]; };
+    vector<int> basis(n);
+    int worst = -1;
+    for (int i = 0; i < n; i++) {
+        const HalfPlane& h = planes[i];
+        double row[5] = {h.a, -h.a, h.b, -h.b, -1.0};
+        for (int j = 0; j < 5; j++) {
+            at(i, j) = row[j];
+        }
+        at(i, 5 + i) = 1.0;
+        at(i, rhs) = h.c;
+        basis[i] = 5 + i;
+        if (h.c < 0 && (worst == -1 || h.c < planes[worst].c)) {
+            worst = i;
+        }
+    }
+    at(n, 4) = 1.0; // Objective row: reduced costs of min t, and -t in the right-hand side.
+
+    auto pivot = [&](int row, int column) {
+        double scale = 1.0 / at(row, column);
+        for (int j = 0; j < columns; j++) {
+            at(row, j) *= scale;
+        }
+        for (int i = 0; i <= n; i++) {
+            double factor = at(i, column);
+            if (i != row && factor != 0.0) {
+                for (int j = 0; j < columns; j++) {
+                    at(i, j) -= factor * at(row, j);
+                }
+            }
+        }
+        basis[row] = column;
+    };
+    if (worst == -1) {
+        return true; // The origin is feasible.
+    }
+    pivot(worst, 4);
+
+    const double eps = 1e-9;
+    for (int iteration = 0; iteration < 50 * (n + 5); iteration++) {
+        int entering = -1;
+        for (int j = 0; j < rhs && entering == -1; j++) {
+            if (at(n, j) < -eps) {
+                entering = j; // Bland: first column with a negative reduced cost
+            }
+        }
+        if (entering == -1) {
+            break;
+        }
+        int leaving = -1;
+        double bestRatio = INFINITY;
+        for (int i = 0; i < n; i++) {
+            if (at(i, entering) > eps) {
+                double ratio = at(i, rhs) / at(i, entering);
+                if (ratio < bestRatio - eps || (ratio < bestRatio + eps && leaving != -1 && basis[i] < basis[leaving])) {
+                    bestRatio = ratio;
+                    leaving = i;
+                }
+            }
+        }
+        if (leaving == -1) {
+            break; // Unbounded objective cannot happen for min t >= 0
+        }
+        pivot(leaving, entering);
+    }
+    return at(n, rhs) > -eps;
+}
+
+/**
+ * @brief Self-check and benchmark of the half-plane intersection engine on random constraint sets.
+ *
+ * Checks that every polygon is convex with its vertices inside every constraint, that the
+ * outcome agrees with the simplex baseline on feasibility, and times both.
+ *
+ * @param sets The number of constraint sets.
+ * @param size The number of constraints per set.
+ * @param threads The number of threads of the batched engine.
+ * @return True if every check passed.
+ */
+bool checkHalfPlanes(int sets, int size, int threads) {
+    srand(12345);
+    auto uniform = []() { return rand() / (double)RAND_MAX; };
+    vector<int> offsets = {0};
+    vector<HalfPlane> planes;
+    for (int s = 0; s < sets; s++) {
+        // Constraints tangent-ish to a circle around a random centre, some pushed inwards past it;
+        // every fourth set keeps its normals in a half-turn, so it is unbounded unless empty.
+        double cx = 10 * uniform() - 5, cy = 10 * uniform() - 5;
+        for (int i = 0; i < size; i++) {
+            double angle = (s % 4 == 3 ? M_PI : 2 * M_PI) * uniform();
+            double a = cos(angle), b = sin(angle), slack = uniform() - (s % 3 == 0 ? 0.6 : 0.05);
+            planes.push_back({a, b, a * cx + b * cy + slack});
+        }
+        offsets.push_back(planes.size());
+    }
+
+    HullSet regions;
+    auto start = chrono::steady_clock::now();
+    vector<Feasibility> serial = intersectHalfPlaneSets(offsets, planes, 1, regions);
+    auto middle = chrono::steady_clock::now();
+    vector<Feasibility> outcomes = intersectHalfPlaneSets(offsets, planes, threads, regions);
+    auto end = chrono::steady_clock::now();
+    vector<bool> feasible(sets);
+    for (int s = 0; s < sets; s++) {
+        feasible[s] = simplexFeasible(planes.data() + offsets[s], offsets[s + 1] - offsets[s]);
+    }
+    auto lpEnd = chrono::steady_clock::now();
+
+    int counts[3] = {0, 0, 0}, disagreements = 0;
+    for (int s = 0; s < sets; s++) {
+        counts[(int)outcomes[s]]++;
+        vector<Point> polygon = regions.polygon(s);
+        int m = polygon.size();
+        bool ok = outcomes[s] == serial[s] && (outcomes[s] == Feasibility::Empty) == (m == 0);
+        for (int i = 0; i < m && ok; i++) {
+            ok = orient2d(polygon[i], polygon[(i + 1) % m], polygon[(i + 2) % m]) >= 0;
+            for (int k = offsets[s]; k < offsets[s + 1] && ok; k++) {
+                const HalfPlane& h = planes[k];
+                ok = h.a * polygon[i].x + h.b * polygon[i].y <= h.c + 1e-9 * max(1.0, abs(polygon[i].x) + abs(polygon[i].y));
+            }
+        }
+        if (!ok) {
+            cout << "Set " << s << ": invalid region" << endl;
+            return false;
+        }
+        disagreements += feasible[s] != (outcomes[s] != Feasibility::Empty);
+    }
+
+    auto ms = [](chrono::steady_clock::time_point a, chrono::steady_clock::time_point b) {
+        return chrono::duration<double, milli>(b - a).count();
+    };
+    cout << sets << " sets of " << size << " half-planes: " << counts[0] << " empty, " << counts[1] << " bounded, "
+         << counts[2] << " unbounded" << endl;
+    cout << "Angle sort and deque: 1 thread " << ms(start, middle) << " ms, " << threads << " threads " << ms(middle, end)
+         << " ms; dense simplex " << ms(end, lpEnd) << " ms" << endl;
+    cout << "Feasibility disagreements with the simplex: " << disagreements << endl;
+    return disagreements == 0;
+}
+
+/**
+ * @brief Lexicographic (x, then y) order of two points.
+ */
+bool lexicographicLess(Point a, Point b) {
+    return a.x < b.x || (a.x == b.x && a.y < b.y);
+}
+
+/**
+ * @brief Andrew's monotone chain over a subset of points, returning indices.
+ *
+ * O(n log n), or O(n) when the candidates are already in lexicographic order, and insensitive to
+ * how the points are distributed.
+ *
+ * @param points The set of points.
+ * @param candidates Indices of the points to take the hull of.
+ * @param hull The vector receiving hull indices in counter-clockwise order, starting at the leftmost point.
+ */
+void monotoneChainIndices(const vector<Point>& points, const vector<int>& candidates, vector<int>& hull) {
+    vector<int> order = candidates;
+    auto less = [&](int i, int j) { return lexicographicLess(points[i], points[j]); };
+    if (!is_sorted(order.begin(), order.end(), less)) {
+        sort(order.begin(), order.end(), less);
+    }
+    int n = order.size();
+    if (n == 0) {
+        return;
+    }
+
+    // Lower chain left to right, then upper chain right to left; collinear points are dropped.
+    vector<int> chain(2 * n);
+    int k = 0;
+    for (int i = 0; i < n; i++) {
+        while (k >= 2 && orient2d(points[chain[k - 2]], points[chain[k - 1]], points[order[i]]) <= 0) {
+            k--;
+        }
+        chain[k++] = order[i];
+    }
+    for (int i = n - 2, lower = k + 1; i >= 0; i--) {
+        while (k >= lower && orient2d(points[chain[k - 2]], points[chain[k - 1]], points[order[i]]) <= 0) {
+            k--;
+        }
+        chain[k++] = order[i];
+    }
+    // The last point closes the cycle; all points coinciding leaves just the first.
+    k = max(1, k - 1);
+    Point first = points[chain[0]];
+    if (k == 2 && points[chain[1]].x == first.x && points[chain[1]].y == first.y) {
+        k = 1;
+    }
+    hull.insert(hull.end(), chain.begin(), chain.begin() + k);
+}
+
+/**
+ * @brief Points that can still be hull vertices after the Akl-Toussaint prefilter.
+ *
+ * Drops every point strictly inside the octagon of the extreme points in the eight compass
+ * directions, which is most of the input for clustered or uniform data. The test is exact.
+ *
+ * @param points The set of points.
+ * @param candidates Indices of the points to filter.
+ * @return The surviving indices, in their original order.
+ */
+vector<int> aklToussaintFilter(const vector<Point>& points, const vector<int>& candidates) {
+    if (candidates.empty()) {
+        return candidates;
+    }
+    // Extremes in counter-clockwise order of their directions: W, SW, S, SE, E, NE, N, NW.
+    int extreme[8];
+    fill(extreme, extreme + 8, candidates[0]);
+    auto key = [](Point p, int direction) {
+        const double keys[8] = {-p.x, -p.x - p.y, -p.y, p.x - p.y, p.x, p.x + p.y, p.y, p.y - p.x};
+        return keys[direction];
+    };
+    for (int i : candidates) {
+        for (int d = 0; d < 8; d++) {
+            if (key(points[i], d) > key(points[extreme[d]], d)) {
+                extreme[d] = i;
+            }
+        }
+    }
+    vector<Point> octagon;
+    for (int d = 0; d < 8; d++) {
+        Point p = points[extreme[d]];
+        if (octagon.empty() || p.x != octagon.back().x || p.y != octagon.back().y) {
+            octagon.push_back(p);
+        }
+    }
+    while (octagon.size() > 1 && octagon.back().x == octagon[0].x && octagon.back().y == octagon[0].y) {
+        octagon.pop_back();
+    }
+    if (octagon.size() < 3) {
+        return candidates;
+    }
+
+    vector<int> survivors;
+    int m = octagon.size();
+    for (int i : candidates) {
+        bool inside = true;
+        for (int e = 0; e < m && inside; e++) {
+            inside = orient2d(octagon[e], octagon[(e + 1) % m], points[i]) > 0;
+        }
+        if (!inside) {
+            survivors.push_back(i);
+        }
+    }
+    return survivors;
+}
+
+/**
+ * @brief Vertex of a convex polygon hit first when a ray from p sweeps it counter-clockwise.
+ *
+ * Every vertex lies left of or on the line from p to the returned one; among vertices on
+ * that line the farthest is returned. Binary search over the edges seen from p, which form
+ * one contiguous run; p must lie outside the polygon or be one of its vertices.
+ *
+ * @param points The set of points.
+ * @param polygon Indices of the polygon vertices, counter-clockwise, without collinear vertices.
+ * @param p The point seen from.
+ * @return The position of the vertex in polygon.
+ */
+int rightTangent(const vector<Point>& points, const vector<int>& polygon, Point p) {
+    int n = polygon.size();
+    auto at = [&](int i) { return points[polygon[i % n]]; };
+    auto same = [](Point a, Point b) { return a.x == b.x && a.y == b.y; };
+    // Edge i runs clockwise as seen from p (ties: its end is farther from p along the same ray).
+    auto down = [&](int i) {
+        Point a = at(i), b = at(i + 1);
+        double side = orient2d(p, a, b);
+        if (side != 0) {
+            return side < 0;
+        }
+        return abs(b.x - p.x) > abs(a.x - p.x) || (abs(b.x - p.x) == abs(a.x - p.x) && abs(b.y - p.y) > abs(a.y - p.y));
+    };
+    if (n <= 2) {
+        return n == 2 && !same(at(1), p) && (same(at(0), p) || down(0)) ? 1 : 0;
+    }
+    if (same(at(0), p)) {
+        return 1;
+    }
+
+    // First index in [lo, hi) where a monotone predicate turns true (hi if never).
+    auto firstTrue = [](int lo, int hi, auto predicate) {
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (predicate(mid)) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        return lo;
+    };
+    Point origin = at(0);
+    if (down(0)) {
+        // The clockwise run starts at or before vertex 0: find where it ends.
+        return firstTrue(1, n, [&](int i) { return !down(i) || orient2d(p, origin, at(i)) >= 0; }) % n;
+    }
+    if (down(n - 1)) {
+        return 0;
+    }
+    // Skip the counter-clockwise run after vertex 0, then the clockwise run.
+    int start = firstTrue(1, n, [&](int i) { return down(i) || orient2d(p, origin, at(i)) <= 0; });
+    return firstTrue(start, n, [&](int i) { return !down(i); }) % n;
+}
+
+/**
+ * @brief Chan's output-sensitive algorithm over a subset of points, returning indices.
+ *
+ * O(n log h): the points are split into groups of m whose hulls come from the monotone chain,
+ * then the hull is gift-wrapped with one binary-searched tangent per group. When more than m
+ * vertices turn up, m is squared and the attempt repeats.
+ *
+ * @param points The set of points.
+ * @param candidates Indices of the points to take the hull of.
+ * @param hull The vector receiving hull indices in counter-clockwise order, starting at the leftmost point.
+ */
+void chanHullIndices(const vector<Point>& points, const vector<int>& candidates, vector<int>& hull) {
+    int n = candidates.size();
+    if (n < 3) {
+        monotoneChainIndices(points, candidates, hull);
+        return;
+    }
+    int start = candidates[0];
+    for (int i : candidates) {
+        if (lexicographicLess(points[i], points[start])) {
+            start = i;
+        }
+    }
+    auto same = [&](int i, int j) { return points[i].x == points[j].x && points[i].y == points[j].y; };
+
+    for (long m = 4;; m = min(m * m, (long)n)) {
+        vector<vector<int>> groups;
+        for (int g = 0; g < n; g += m) {
+            vector<int> members(candidates.begin() + g, candidates.begin() + min((long)n, g + m)), groupHull;
+            monotoneChainIndices(points, members, groupHull);
+            groups.push_back(groupHull);
+        }
+
+        vector<int> wrapped = {start};
+        for (long step = 0; step < m; step++) {
+            Point p = points[wrapped.back()];
+            int best = -1;
+            for (const vector<int>& group : groups) {
+                int q = group[rightTangent(points, group, p)];
+                if (same(q, wrapped.back())) {
+                    continue;
+                }
+                if (best == -1) {
+                    best = q;
+                    continue;
+                }
+                double side = orient2d(p, points[best], points[q]);
+                Point b = points[best], c = points[q];
+                bool farther = abs(c.x - p.x) > abs(b.x - p.x) || (abs(c.x - p.x) == abs(b.x - p.x) && abs(c.y - p.y) > abs(b.y - p.y));
+                if (side < 0 || (side == 0 && farther)) {
+                    best = q;
+                }
+            }
+            if (best == -1 || same(best, start)) {
+                hull.insert(hull.end(), wrapped.begin(), wrapped.end());
+                return;
+            }
+            wrapped.push_back(best);
+        }
+    }
+}
+
+/**
+ * @brief The hull engines benchmarked by --check-engines; all but Chan are candidates of the auto mode.
+ */
+enum class HullEngine {
+    QuickHull,     /**< Divide and conquer, fast on uniform data with few hull vertices */
+    MonotoneChain, /**< Sort and scan, predictable on any input, linear on sorted input */
+    Chan,          /**< Output-sensitive; benchmarked only, as it is never the fastest on any class */
+    Prefiltered    /**< Akl-Toussaint prefilter, then the monotone chain on the survivors */
+};
+
+const HullEngine hullCandidates[] = {HullEngine::QuickHull, HullEngine::MonotoneChain, HullEngine::Prefiltered};
+
+const char* hullEngineName(HullEngine engine) {
+    const char* names[] = {"quickhull", "monotone-chain", "chan", "prefiltered"};
+    return names[(int)engine];
+}
+
+/**
+ * @brief Run one hull engine over all points.
+ */
+void runHullEngine(HullEngine engine, const vector<Point>& points, vector<int>& hull) {
+    vector<int> all(points.size());
+    for (size_t i = 0; i < points.size(); i++) {
+        all[i] = i;
+    }
+    switch (engine) {
+    case HullEngine::QuickHull:
+        quickHullIndices(points, all, hull);
+        break;
+    case HullEngine::MonotoneChain:
+        monotoneChainIndices(points, all, hull);
+        break;
+    case HullEngine::Chan:
+        chanHullIndices(points, all, hull);
+        break;
+    case HullEngine::Prefiltered:
+        monotoneChainIndices(points, aklToussaintFilter(points, all), hull);
+        break;
+    }
+}
+
+/**
+ * @struct HullStats
+ * @brief What the auto mode measured on its sample, what it predicted, and what it chose.
+ */
+struct HullStats {
+    int sampleSize = 0;
+    double hullFraction = 0;   /**< Fraction of the sample on the sample's hull */
+    double insideFraction = 0; /**< Fraction of the sample the prefilter drops */
+    double sortedness = 0;     /**< Fraction of consecutive sample pairs in lexicographic order */
+    double expectedHull = 0;   /**< Hull size extrapolated to all points */
+    double predicted[4] = {0, 0, 0, 0}; /**< Predicted cost of every candidate engine, in nanoseconds; infinite for the others */
+    HullEngine engine = HullEngine::QuickHull;
+};
+
+/**
+ * @brief Pick the hull engine with the lowest predicted cost from a sample of the points.
+ *
+ * Takes a few thousand evenly spaced points and measures how many of them are on their own hull,
+ * how many the prefilter would drop, and how sorted they are. The hull size is extrapolated
+ * from two nested samples: h grows like n^e, with e near 0 for uniform data in a polygon, 1/3
+ * in a disc and 1 for points in convex position. The per-point constants were fitted to the
+ * first seven classes of --check-engines; the classes from collinear on are held out and
+ * validate them, and the choice stays the fastest candidate on all of them. The absolute
+ * predictions are rougher where the points crowd the hull: exactly collinear input sends
+ * every predicate to exact arithmetic, and a thin annulus leaves quickhull many points near
+ * the hull, so both run several times over their prediction, though the ranking holds.
+ * Chan's algorithm is not a candidate: it costs about 108 n log2 h against quickhull's
+ * 60 n + 45 h log2 h, so no hull size makes it the cheaper one, and it was never measured
+ * fastest on any class.
+ *
+ * @param points The set of points.
+ * @return The sample statistics, predicted costs and the choice.
+ */
+HullStats chooseHullEngine(const vector<Point>& points) {
+    HullStats stats;
+    // A sixteenth of the input, at least 256 points and at most 4096, so small inputs stay cheap.
+    int n = points.size();
+    int s = min(4096, max(n / 16, min(n, 256)));
+    stats.sampleSize = s;
+    stats.predicted[(int)HullEngine::Chan] = INFINITY;
+    if (s < 3) {
+        stats.engine = HullEngine::MonotoneChain;
+        return stats;
+    }
+
+    vector<Point> sample(s);
+    int ordered = 0;
+    for (int i = 0; i < s; i++) {
+        sample[i] = points[(long)i * n / s];
+        ordered += i > 0 && !lexicographicLess(sample[i], sample[i - 1]);
+    }
+    stats.sortedness = ordered / (double)(s - 1);
+
+    vector<int> all(s), half(s / 2), hull, halfHull;
+    for (int i = 0; i < s; i++) {
+        all[i] = i;
+    }
+    for (int i = 0; i < s / 2; i++) {
+        half[i] = 2 * i;
+    }
+    monotoneChainIndices(sample, all, hull);
+    monotoneChainIndices(sample, half, halfHull);
+    stats.hullFraction = hull.size() / (double)s;
+    stats.insideFraction = 1 - aklToussaintFilter(sample, all).size() / (double)s;
+
+    // h(n) = h(s) * (n / s)^e, with e from doubling the sample.
+    double exponent = log2(max(1.0, (double)hull.size()) / max(1.0, (double)halfHull.size()));
+    exponent = min(1.0, max(0.0, exponent));
+    stats.expectedHull = min((double)n, hull.size() * pow(n / (double)s, exponent));
+
+    // QuickHull pays a pass over the points, then a level per hull doubling for the points left near the hull.
+    double h = stats.expectedHull, survivors = max(h, (1 - stats.insideFraction) * n);
+    auto chainCost = [&](double count, bool sorted) { return count * (sorted ? 70.0 : 27.0 * log2(count + 2)); };
+    stats.predicted[(int)HullEngine::QuickHull] = 60.0 * n + 45.0 * h * log2(h + 2);
+    stats.predicted[(int)HullEngine::MonotoneChain] = chainCost(n, stats.sortedness > 0.999);
+    stats.predicted[(int)HullEngine::Prefiltered] = 95.0 * n + chainCost(survivors, stats.sortedness > 0.999);
+    for (HullEngine e : hullCandidates) {
+        if (stats.predicted[(int)e] < stats.predicted[(int)stats.engine]) {
+            stats.engine = e;
+        }
+    }
+    return stats;
+}
+
+/**
+ * @brief Convex hull with the engine chosen by chooseHullEngine.
+ *
+ * @param points The set of points.
+ * @param hull The vector receiving hull indices in counter-clockwise order, starting at the leftmost point.
+ * @return The decision and what it was based on.
+ */
+HullStats autoHull(const vector<Point>& points, vector<int>& hull) {
+    HullStats stats = chooseHullEngine(points);
+    runHullEngine(stats.engine, points, hull);
+    return stats;
+}
+
+/**
+ * @brief Print the statistics of an auto mode decision.
+ */
+void printHullStats(const HullStats& stats) {
+    if (stats.sampleSize < 3) {
+        cout << "Engine: " << hullEngineName(stats.engine) << " (" << stats.sampleSize << " points, nothing to sample)" << endl;
+        return;
+    }
+    cout << "Engine: " << hullEngineName(stats.engine) << " (sample " << stats.sampleSize << ", on hull "
+         << stats.hullFraction << ", dropped by prefilter " << stats.insideFraction << ", sortedness " << stats.sortedness
+         << ", expected hull " << stats.expectedHull << ")" << endl;
+    cout << "Predicted cost (ms):";
+    for (HullEngine e : hullCandidates) {
+        cout << " " << hullEngineName(e) << " " << stats.predicted[(int)e] * 1e-6;
+    }
+    cout << endl;
+}
+
+/**
+ * @brief Benchmark every hull engine on a suite of distributions and validate the auto mode.
+ *
+ * Checks that every engine returns the same vertex list, that the list is the strict hull
+ * (only the two extreme points for collinear input, each duplicated vertex once), and reports
+ * the measured time of every engine next to the prediction and the choice of the auto mode.
+ * The classes from collinear on were not used to fit the cost constants. On every class the
+ * engine the auto mode chooses must run within twice the time of the fastest candidate,
+ * checked only where that takes at least 10 ms, so timer noise cannot fail it.
+ *
+ * @param n The number of points per distribution.
+ * @return True if every engine agreed on every distribution and the choice held up.
+ */
+bool checkHullEngines(int n) {
+    srand(12345);
+    auto uniform = []() { return rand() / (double)RAND_MAX; };
+    const char* names[] = {"uniform square", "uniform disc", "circle",   "clusters",      "sorted square",
+                           "triangle",       "grid",         "collinear", "vertical",     "duplicates",
+                           "gaussian",       "annulus",      "parabola",  "reversed square", "sorted circle"};
+    const int kinds = sizeof(names) / sizeof(names[0]);
+    bool passed = true;
+    for (int kind = 0; kind < kinds; kind++) {
+        vector<Point> points(n), distinct(64);
+        for (Point& d : distinct) {
+            d = {(double)(rand() % 1000), (double)(rand() % 1000)};
+        }
+        for (int i = 0; i < n; i++) {
+            double r = sqrt(uniform()), angle = 2 * M_PI * uniform();
+            double u = uniform(), v = uniform();
+            switch (kind) {
+            case 0:
+            case 4:
+                points[i] = {u, v};
+                break;
+            case 1:
+                points[i] = {r * cos(angle), r * sin(angle)};
+                break;
+            case 2:
+                points[i] = {cos(angle), sin(angle)};
+                break;
+            case 3: {
+                // Tight blobs around a few centres.
+                int c = rand() % 8;
+                double g = sqrt(-2 * log(max(u, 1e-300))) * cos(2 * M_PI * v);
+                double h = sqrt(-2 * log(max(u, 1e-300))) * sin(2 * M_PI * v);
+                points[i] = {cos(c) * 10 + 0.1 * g, sin(3 * c) * 10 + 0.1 * h};
+                break;
+            }
+            case 5:
+                points[i] = u + v > 1 ? Point{1 - u, 1 - v} : Point{u, v};
+                break;
+            case 6:
+                points[i] = {(double)(rand() % 100), (double)(rand() % 100)};
+                break;
+            case 7: {
+                // Exactly on one line: small integers keep 3x - 7 exact.
+                double x = rand() % 1000000;
+                points[i] = {x, 3 * x - 7};
+                break;
+            }
+            case 8:
+                points[i] = {5.0, (double)(rand() % 1000000)};
+                break;
+            case 9:
+                points[i] = distinct[rand() % distinct.size()];
+                break;
+            case 10:
+                points[i] = {sqrt(-2 * log(max(u, 1e-300))) * cos(2 * M_PI * v), sqrt(-2 * log(max(u, 1e-300))) * sin(2 * M_PI * v)};
+                break;
+            case 11:
+                points[i] = {(0.99 + 0.01 * u) * cos(angle), (0.99 + 0.01 * u) * sin(angle)};
+                break;
+            case 12:
+                points[i] = {2 * u - 1, (2 * u - 1) * (2 * u - 1)};
+                break;
+            case 13:
+                points[i] = {u, v};
+                break;
+            case 14:
+                points[i] = {cos(angle), sin(angle)};
+                break;
+            }
+        }
+        if (kind == 4 || kind == 14) {
+            sort(points.begin(), points.end(), lexicographicLess);
+        }
+        if (kind == 13) {
+            sort(points.begin(), points.end(), [](Point a, Point b) { return lexicographicLess(b, a); });
+        }
+
+        vector<int> reference;
+        double times[4];
+        for (int e = 0; e < 4; e++) {
+            vector<int> hull;
+            auto start = chrono::steady_clock::now();
+            runHullEngine((HullEngine)e, points, hull);
+            times[e] = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            bool same = e == 0 || hull.size() == reference.size();
+            for (size_t k = 0; same && e > 0 && k < hull.size(); k++) {
+                same = points[hull[k]].x == points[reference[k]].x && points[hull[k]].y == points[reference[k]].y;
+            }
+            if (e == 0) {
+                reference = hull;
+            }
+            if (!same) {
+                cout << names[kind] << ": " << hullEngineName((HullEngine)e) << " differs from quickhull" << endl;
+                passed = false;
+            }
+        }
+
+        // The reference itself: the two extremes when the input is collinear (one point if they
+        // coincide), else a strict hull, checked against every point where that stays cheap.
+        vector<Point> vertices;
+        for (int v : reference) {
+            vertices.push_back(points[v]);
+        }
+        Point lowest = *min_element(points.begin(), points.end(), lexicographicLess);
+        Point highest = *max_element(points.begin(), points.end(), lexicographicLess);
+        bool collinear = true;
+        for (size_t i = 0; collinear && i < points.size(); i++) {
+            collinear = orient2d(lowest, highest, points[i]) == 0;
+        }
+        bool valid;
+        if (collinear) {
+            size_t ends = lowest.x == highest.x && lowest.y == highest.y ? 1 : 2;
+            valid = vertices.size() == ends && vertices[0].x == lowest.x && vertices[0].y == lowest.y &&
+                    vertices.back().x == highest.x && vertices.back().y == highest.y;
+        } else {
+            valid = vertices.size() >= 3 && (vertices.size() * (double)n > 2e8 || isStrictHull(points, vertices));
+        }
+        if (!valid) {
+            cout << names[kind] << ": hull of " << vertices.size() << " vertices is not the strict hull" << endl;
+            passed = false;
+        }
+
+        vector<int> hull;
+        auto start = chrono::steady_clock::now();
+        HullStats stats = autoHull(points, hull);
+        double autoTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        int fastest = min_element(times, times + 4) - times;
+        double fastestCandidate = INFINITY;
+        for (HullEngine e : hullCandidates) {
+            fastestCandidate = min(fastestCandidate, times[(int)e]);
+        }
+        double regret = times[(int)stats.engine] / fastestCandidate;
+        cout << names[kind] << (kind >= 7 ? " (held out)" : "") << ", " << n << " points, hull " << reference.size() << ":";
+        for (int e = 0; e < 4; e++) {
+            cout << " " << hullEngineName((HullEngine)e) << " " << times[e] << " ms";
+        }
+        cout << endl << "  auto " << autoTime << " ms, fastest " << hullEngineName((HullEngine)fastest) << ", chosen engine at "
+             << regret << "x the fastest candidate; ";
+        printHullStats(stats);
+        if (fastestCandidate >= 10 && regret > 2) {
+            cout << names[kind] << ": the auto mode chose " << hullEngineName(stats.engine) << ", " << regret
+                 << " times slower than the fastest candidate" << endl;
+            passed = false;
+        }
+    }
+    return passed;
+}
+
+/**
+ * @struct Vec3
+ * @brief A struct representing a 3D vector, used for points on the unit sphere.
+ */
+struct Vec3 {
+    double x, y, z;
+};
+
+Vec3 operator+(Vec3 a, Vec3 b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+Vec3 operator-(Vec3 a, Vec3 b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+Vec3 operator*(Vec3 a, double s) { return {a.x * s, a.y * s, a.z * s}; }
+double dot(Vec3 a, Vec3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+Vec3 cross(Vec3 a, Vec3 b) { return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x}; }
+double norm(Vec3 a) { return sqrt(dot(a, a)); }
+
+/**
+ * @brief Convert a geographic coordinate to a unit vector.
+ *
+ * @param p The point, with x = longitude and y = latitude in degrees.
+ * @return The corresponding point on the unit sphere.
+ */
+Vec3 lonLatToUnit(Point p) {
+    const double degToRad = M_PI / 180.0;
+    double lon = p.x * degToRad, lat = p.y * degToRad;
+    return {cos(lat) * cos(lon), cos(lat) * sin(lon), sin(lat)};
+}
+
+/**
+ * @struct Face3
+ * @brief A triangular face of a 3D convex hull, given by point indices in outward (counter-clockwise) order.
+ */
+struct Face3 {
+    int a, b, c;
+};
+
+/**
+ * @brief Signed volume telling on which side of face (a, b, c) the point p lies.
+ *
+ * @return A positive value if p lies outside the face.
+ */
+double faceVolume(const vector<Vec3>& v, const Face3& f, Vec3 p) {
+    return dot(cross(v[f.b] - v[f.a], v[f.c] - v[f.a]), p - v[f.a]);
+}
+
+/**
+ * @brief Incremental 3D convex hull.
+ *
+ * @param v The set of points.
+ * @param faces The vector receiving the hull faces. Left empty if all points are coplanar.
+ */
+void convexHull3D(const vector<Vec3>& v, vector<Face3>& faces) {
+    const double eps = 1e-12;
+    int n = v.size();
+    if (n < 4) {
+        return;
+    }
+
+    // Build an initial tetrahedron from four points in general position.
+    int i0 = 0, i1 = -1, i2 = -1, i3 = -1;
+    double best = eps;
+    for (int i = 1; i < n; i++) {
+        if (norm(v[i] - v[i0]) > best) {
+            best = norm(v[i] - v[i0]);
+            i1 = i;
+        }
+    }
+    if (i1 < 0) {
+        return;
+    }
+    best = eps;
+    for (int i = 0; i < n; i++) {
+        double area = norm(cross(v[i1] - v[i0], v[i] - v[i0]));
+        if (area > best) {
+            best = area;
+            i2 = i;
+        }
+    }
+    if (i2 < 0) {
+        return;
+    }
+    best = eps;
+    for (int i = 0; i < n; i++) {
+        double volume = abs(faceVolume(v, {i0, i1, i2}, v[i]));
+        if (volume > best) {
+            best = volume;
+            i3 = i;
+        }
+    }
+    if (i3 < 0) {
+        return;
+    }
+
+    if (faceVolume(v, {i0, i1, i2}, v[i3]) > 0) {
+        swap(i1, i2);
+    }
+    faces = {{i0, i1, i2}, {i0, i3, i1}, {i1, i3, i2}, {i2, i3, i0}};
+
+    for (int p = 0; p < n; p++) {
+        if (p == i0 || p == i1 || p == i2 || p == i3) {
+            continue;
+        }
+
+        vector<bool> visible(faces.size());
+        bool anyVisible = false;
+        for (size_t f = 0; f < faces.size(); f++) {
+            visible[f] = faceVolume(v, faces[f], v[p]) > eps;
+            anyVisible = anyVisible || visible[f];
+        }
+        if (!anyVisible) {
+            continue; // Point lies inside the current hull.
+        }
+
+        // Horizon edges belong to exactly one visible face.
+        vector<pair<int, int>> edges;
+        for (size_t f = 0; f < faces.size(); f++) {
+            if (visible[f]) {
+                edges.push_back({faces[f].a, faces[f].b});
+                edges.push_back({faces[f].b, faces[f].c});
+                edges.push_back({faces[f].c, faces[f].a});
+            }
+        }
+
+        vector<Face3> kept;
+        for (size_t f = 0; f < faces.size(); f++) {
+            if (!visible[f]) {
+                kept.push_back(faces[f]);
+            }
+        }
+        for (const auto& e : edges) {
+            if (find(edges.begin(), edges.end(), make_pair(e.second, e.first)) == edges.end()) {
+                kept.push_back({e.first, e.second, p});
+            }
+        }
+        faces = kept;
+    }
+}
+
+/**
+ * @brief Convex hull of geographic points on the sphere.
  *
- * @param a The first point of the line segment.
- * @param b The second point of the line segment.
- * @param p The point for which distance is to be calculated.
- * @return The distance between point p and the line segment defined by points a and b.
+ * If the points fit in an open hemisphere around their centroid, they are mapped with a
+ * gnomonic projection centred there. The projection sends great circles to straight lines,
+ * so the planar QuickHull of the projected points is exactly the spherical hull, and
+ * its indices map back to the input. The centroid test is sufficient but not necessary;
+ * point sets failing it fall back to a 3D hull of the unit vectors.
+ *
+ * @param points The set of points, with x = longitude and y = latitude in degrees.
+ * @param hull Receives hull indices, counter-clockwise as seen from outside the sphere (hemisphere case).
+ * @param faces Receives the 3D hull faces (fallback case).
+ * @return True if the hemisphere case applied, false if the 3D fallback was used.
  */
-double distance(Point a, Point b, Point p) {
-    return abs((b.x - a.x) * (a.y - p.y) - (a.x - p.x) * (b.y - a.y)) / sqrt((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y));
+bool sphericalHull(const vector<Point>& points, vector<int>& hull, vector<Face3>& faces) {
+    vector<Vec3> unit;
+    Vec3 sum = {0, 0, 0};
+    for (const Point& p : points) {
+        unit.push_back(lonLatToUnit(p));
+        sum = sum + unit.back();
+    }
+
+    bool inHemisphere = norm(sum) > 1e-9;
+    Vec3 centre = inHemisphere ? sum * (1.0 / norm(sum)) : sum;
+    for (const Vec3& u : unit) {
+        if (!inHemisphere || dot(u, centre) <= 1e-9) {
+            inHemisphere = false;
+            break;
+        }
+    }
+
+    if (!inHemisphere) {
+        convexHull3D(unit, faces);
+        return false;
+    }
+
+    // Tangent basis at the centre: east and north (any orthonormal pair works at the poles).
+    Vec3 east = cross({0, 0, 1}, centre);
+    if (norm(east) < 1e-12) {
+        east = {0, 1, 0};
+    }
+    east = east * (1.0 / norm(east));
+    Vec3 north = cross(centre, east);
+
+    vector<Point> projected;
+    vector<int> candidates;
+    for (size_t i = 0; i < unit.size(); i++) {
+        double d = dot(unit[i], centre);
+        projected.push_back({dot(unit[i], east) / d, dot(unit[i], north) / d});
+        candidates.push_back(i);
+    }
+
+    quickHullIndices(projected, candidates, hull);
+    return true;
 }
 
 /**
- * @brief Find the point with the maximum distance from a line segment.
+ * @struct Triangulation
+ * @brief A Delaunay triangulation in compact index-based half-edge form.
  *
- * @param points The set of points to search.
- * @param a The first point of the line segment.
- * @param b The second point of the line segment.
- * @return The index of the point in the points vector with the maximum distance from the line segment.
+ * Triangle t has the point indices triangles[3t], triangles[3t + 1], triangles[3t + 2] in
+ * counter-clockwise order. Half-edge e runs from triangles[e] to the next vertex of its
+ * triangle, and halfedges[e] is the opposite half-edge in the neighbouring triangle, or -1
+ * on the boundary. hull lists the boundary vertices in counter-clockwise order.
  */
-int findMaxDistancePoint(vector<Point>& points, int a, int b) {
-    double maxDist = -1;
-    int maxPointIndex = -1;
+struct Triangulation {
+    vector<int> triangles;
+    vector<int> halfedges;
+    vector<int> hull;
+};
 
-    for (int i = 0; i < points.size(); i++) {
-        double dist = distance(points[a], points[b], points[i]);
-        if (dist > maxDist) {
-            maxDist = dist;
-            maxPointIndex = i;
+/**
+ * @brief Index of the next half-edge within the same triangle.
+ */
+int nextHalfedge(int e) {
+    return e % 3 == 2 ? e - 2 : e + 1;
+}
+
+/**
+ * @brief Index of the previous half-edge within the same triangle.
+ */
+int prevHalfedge(int e) {
+    return e % 3 == 0 ? e + 2 : e - 1;
+}
+
+/**
+ * @brief Monotone substitute for the angle of (dx, dy), in [0, 1).
+ */
+double pseudoAngle(double dx, double dy) {
+    double p = dx / (abs(dx) + abs(dy));
+    return (dy > 0 ? 3 - p : 1 + p) / 4;
+}
+
+/**
+ * @brief Squared circumradius of a triangle, or infinity for a degenerate one.
+ */
+double circumradius2(Point a, Point b, Point c) {
+    double dx = b.x - a.x, dy = b.y - a.y;
+    double ex = c.x - a.x, ey = c.y - a.y;
+    double bl = dx * dx + dy * dy, cl = ex * ex + ey * ey;
+    double d = 0.5 / (dx * ey - dy * ex);
+    double x = (ey * bl - dy * cl) * d, y = (dx * cl - ex * bl) * d;
+    return isfinite(x) && isfinite(y) ? x * x + y * y : INFINITY;
+}
+
+/**
+ * @brief Circumcentre of a non-degenerate triangle.
+ */
+Point circumcenter(Point a, Point b, Point c) {
+    double dx = b.x - a.x, dy = b.y - a.y;
+    double ex = c.x - a.x, ey = c.y - a.y;
+    double bl = dx * dx + dy * dy, cl = ex * ex + ey * ey;
+    double d = 0.5 / (dx * ey - dy * ex);
+    return {a.x + (ey * bl - dy * cl) * d, a.y + (dx * cl - ex * bl) * d};
+}
+
+/**
+ * @class DelaunayBuilder
+ * @brief Incremental radial-sweep Delaunay triangulation.
+ *
+ * Points are inserted in order of distance from the circumcentre of a seed triangle, so every
+ * new point lies outside the current triangulation. Each insertion fans triangles onto the
+ * visible boundary edges and restores the Delaunay property by edge flips. The boundary is the
+ * convex hull of the inserted points at every step, so no super-triangle is needed.
+ */
+class DelaunayBuilder {
+public:
+    DelaunayBuilder(const vector<Point>& points) : points(points) {}
+
+    /**
+     * @brief Triangulate the points.
+     * @return The triangulation. Empty if fewer than three non-collinear points are given.
+     */
+    Triangulation build();
+
+private:
+    const vector<Point>& points;
+    Triangulation result;
+    vector<int> hullPrev, hullNext, hullTri, hullHash;
+    Point centre;
+
+    int hashKey(Point p) const {
+        int size = hullHash.size();
+        return (int)floor(pseudoAngle(p.x - centre.x, p.y - centre.y) * size) % size;
+    }
+
+    void link(int a, int b) {
+        result.halfedges[a] = b;
+        if (b != -1) {
+            result.halfedges[b] = a;
         }
     }
 
-    return maxPointIndex;
+    int addTriangle(int i0, int i1, int i2, int a, int b, int c) {
+        int t = result.triangles.size();
+        result.triangles.insert(result.triangles.end(), {i0, i1, i2});
+        result.halfedges.insert(result.halfedges.end(), {-1, -1, -1});
+        link(t, a);
+        link(t + 1, b);
+        link(t + 2, c);
+        return t;
+    }
+
+    void legalize(int edge);
+};
+
+/**
+ * @brief Flip edges until every edge reachable from the given one is locally Delaunay.
+ *
+ * @param edge A half-edge whose triangle apex is the most recently inserted point.
+ */
+void DelaunayBuilder::legalize(int edge) {
+    vector<int>& triangles = result.triangles;
+    vector<int>& halfedges = result.halfedges;
+    vector<int> stack = {edge};
+
+    while (!stack.empty()) {
+        int a = stack.back();
+        stack.pop_back();
+        int b = halfedges[a];
+        if (b == -1) {
+            continue;
+        }
+
+        int al = nextHalfedge(a), ar = prevHalfedge(a);
+        int bl = prevHalfedge(b), bn = nextHalfedge(b);
+        int p0 = triangles[ar], pr = triangles[a], pl = triangles[al], p1 = triangles[bl];
+
+        if (incircle(points[pr], points[pl], points[p0], points[p1]) <= 0) {
+            continue;
+        }
+
+        // Flip the shared edge pr-pl to p0-p1.
+        triangles[a] = p1;
+        triangles[b] = p0;
+        int hbl = halfedges[bl], har = halfedges[ar];
+        link(a, hbl);
+        link(b, har);
+        link(ar, bl);
+
+        // Boundary edges that changed slot keep their hull references in sync.
+        if (hbl == -1) {
+            hullTri[p1] = a;
+        }
+        if (har == -1) {
+            hullTri[p0] = b;
+        }
+
+        stack.push_back(a);
+        stack.push_back(bn);
+    }
+}
+
+Triangulation DelaunayBuilder::build() {
+    int n = points.size();
+    result = Triangulation();
+    if (n < 3) {
+        return result;
+    }
+
+    // Seed: the point nearest the bounding box centre, its nearest neighbour, and the point
+    // forming the smallest circumcircle with them.
+    double minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+    for (const Point& p : points) {
+        minX = min(minX, p.x);
+        minY = min(minY, p.y);
+        maxX = max(maxX, p.x);
+        maxY = max(maxY, p.y);
+    }
+    Point boxCentre = {(minX + maxX) / 2, (minY + maxY) / 2};
+
+    auto dist2 = [](Point a, Point b) { return (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y); };
+
+    int i0 = 0, i1 = -1, i2 = -1;
+    for (int i = 1; i < n; i++) {
+        if (dist2(points[i], boxCentre) < dist2(points[i0], boxCentre)) {
+            i0 = i;
+        }
+    }
+    double best = INFINITY;
+    for (int i = 0; i < n; i++) {
+        double d = dist2(points[i], points[i0]);
+        if (d > 0 && d < best) {
+            best = d;
+            i1 = i;
+        }
+    }
+    if (i1 < 0) {
+        return result;
+    }
+    best = INFINITY;
+    for (int i = 0; i < n; i++) {
+        if (orient2d(points[i0], points[i1], points[i]) == 0) {
+            continue;
+        }
+        double r = circumradius2(points[i0], points[i1], points[i]);
+        if (r < best) {
+            best = r;
+            i2 = i;
+        }
+    }
+    if (i2 < 0) {
+        return result; // All points are collinear.
+    }
+    if (orient2d(points[i0], points[i1], points[i2]) < 0) {
+        swap(i1, i2);
+    }
+
+    centre = circumcenter(points[i0], points[i1], points[i2]);
+    vector<int> order;
+    vector<double> dists(n);
+    for (int i = 0; i < n; i++) {
+        dists[i] = dist2(points[i], centre);
+        if (i != i0 && i != i1 && i != i2) {
+            order.push_back(i);
+        }
+    }
+    sort(order.begin(), order.end(), [&](int a, int b) { return dists[a] < dists[b]; });
+
+    int hashSize = max(1, (int)ceil(sqrt((double)n)));
+    hullPrev.assign(n, -1);
+    hullNext.assign(n, -1);
+    hullTri.assign(n, -1);
+    hullHash.assign(hashSize, -1);
+    result.triangles.reserve(6 * n);
+    result.halfedges.reserve(6 * n);
+
+    int hullStart = i0;
+    hullNext[i0] = hullPrev[i2] = i1;
+    hullNext[i1] = hullPrev[i0] = i2;
+    hullNext[i2] = hullPrev[i1] = i0;
+    hullTri[i0] = 0;
+    hullTri[i1] = 1;
+    hullTri[i2] = 2;
+    hullHash[hashKey(points[i0])] = i0;
+    hullHash[hashKey(points[i1])] = i1;
+    hullHash[hashKey(points[i2])] = i2;
+    addTriangle(i0, i1, i2, -1, -1, -1);
+
+    for (int i : order) {
+        Point p = points[i];
+
+        // Find a boundary vertex near p's angle, then walk to the first visible edge.
+        int start = -1;
+        int key = hashKey(p);
+        for (int j = 0; j < hashSize; j++) {
+            start = hullHash[(key + j) % hashSize];
+            if (start != -1 && start != hullNext[start]) {
+                break;
+            }
+        }
+        start = hullPrev[start];
+        int e = start;
+        while (!(orient2d(points[e], points[hullNext[e]], p) < 0)) {
+            e = hullNext[e];
+            if (e == start) {
+                e = -1;
+                break;
+            }
+        }
+        if (e == -1) {
+            continue; // Duplicate point.
+        }
+
+        int t = addTriangle(e, i, hullNext[e], -1, -1, hullTri[e]);
+        hullTri[i] = t + 1;
+        hullTri[e] = t;
+        legalize(t + 2);
+
+        // Walk forward along the boundary, covering every visible edge.
+        int next = hullNext[e];
+        for (int q = hullNext[next]; orient2d(points[next], points[q], p) < 0; q = hullNext[next]) {
+            t = addTriangle(next, i, q, hullTri[i], -1, hullTri[next]);
+            hullTri[i] = t + 1;
+            legalize(t + 2);
+            hullNext[next] = next; // Mark as removed from the boundary.
+            next = q;
+        }
+
+        // Walk backward from the other side.
+        if (e == start) {
+            for (int q = hullPrev[e]; orient2d(points[q], points[e], p) < 0; q = hullPrev[e]) {
+                t = addTriangle(q, i, e, -1, hullTri[e], hullTri[q]);
+                hullTri[q] = t;
+                legalize(t + 2);
+                hullNext[e] = e;
+                e = q;
+            }
+        }
+
+        hullStart = e;
+        hullPrev[i] = e;
+        hullNext[e] = i;
+        hullPrev[next] = i;
+        hullNext[i] = next;
+        hullHash[hashKey(p)] = i;
+        hullHash[hashKey(points[e])] = e;
+    }
+
+    int e = hullStart;
+    do {
+        result.hull.push_back(e);
+        e = hullNext[e];
+    } while (e != hullStart);
+
+    return result;
 }
 
 /**
- * @brief QuickHull algorithm to find the convex hull of a set of points.
+ * @brief Restore the Delaunay property by Lawson flips, starting from the given half-edges.
+ *
+ * Unlike DelaunayBuilder::legalize, a flipped quadrilateral has no newly inserted apex, so all
+ * four of its outer edges are rechecked. Edges never reached keep both their triangles and stay
+ * locally Delaunay, so the result is Delaunay if the unreached edges were.
  *
  * @param points The set of points.
- * @param left The index of the leftmost point.
- * @param right The index of the rightmost point.
- * @param convexHull The vector to store the points of the convex hull.
+ * @param t The triangulation, modified in place.
+ * @param boundaryOut boundaryOut[v] is the boundary half-edge leaving v, kept in sync.
+ * @param stack The half-edges to check first.
  */
-void quickHull(vector<Point>& points, int left, int right, vector<Point>& convexHull) {
-    if (points.empty() || left >= right) {
-        return; // Base case: No points or only one point, nothing to do.
+void lawsonFlips(const vector<Point>& points, Triangulation& t, vector<int>& boundaryOut, vector<int> stack) {
+    vector<int>& triangles = t.triangles;
+    vector<int>& halfedges = t.halfedges;
+    auto link = [&](int a, int b) {
+        halfedges[a] = b;
+        if (b != -1) {
+            halfedges[b] = a;
+        }
+    };
+
+    while (!stack.empty()) {
+        int a = stack.back();
+        stack.pop_back();
+        int b = halfedges[a];
+        if (b == -1) {
+            continue;
+        }
+
+        int al = nextHalfedge(a), ar = prevHalfedge(a);
+        int bl = prevHalfedge(b), bn = nextHalfedge(b);
+        int p0 = triangles[ar], pr = triangles[a], pl = triangles[al], p1 = triangles[bl];
+
+        if (incircle(points[pr], points[pl], points[p0], points[p1]) <= 0) {
+            continue;
+        }
+
+        // Flip the shared edge pr-pl to p0-p1, as in DelaunayBuilder::legalize.
+        triangles[a] = p1;
+        triangles[b] = p0;
+        int hbl = halfedges[bl], har = halfedges[ar];
+        link(a, hbl);
+        link(b, har);
+        link(ar, bl);
+        if (hbl == -1) {
+            boundaryOut[p1] = a;
+        }
+        if (har == -1) {
+            boundaryOut[p0] = b;
+        }
+
+        stack.insert(stack.end(), {a, al, b, bn});
     }
+}
 
-    // Find the referential point as the point with the lowest x-coordinate.
-    int referentialIndex = left;
-    for (int i = left; i <= right; i++) {
-        if (points[i].x < points[referentialIndex].x) {
-            referentialIndex = i;
+/**
+ * @brief Triangulate the gap between two lexicographically separated triangulations.
+ *
+ * Finds the lower common tangent of the two boundaries and zips triangles upwards between them
+ * until the upper tangent, taking the next vertex of whichever side keeps the new edge inside
+ * the gap and, when both do, the one whose triangle is Delaunay. The boundary cycles are joined
+ * into the boundary of the union.
+ *
+ * @param points The set of points.
+ * @param t The triangulation holding both parts, modified in place.
+ * @param hullNext, hullPrev The boundary cycles of both parts in counter-clockwise order.
+ * @param boundaryOut boundaryOut[v] is the boundary half-edge leaving v.
+ * @param l A boundary vertex of the left part with the lexicographically largest point.
+ * @param r A boundary vertex of the right part with the lexicographically smallest point.
+ * @param seam Receives the half-edges of the new triangles.
+ */
+void zipTriangulations(const vector<Point>& points, Triangulation& t, vector<int>& hullNext, vector<int>& hullPrev,
+                       vector<int>& boundaryOut, int l, int r, vector<int>& seam) {
+    for (bool moved = true; moved;) {
+        moved = false;
+        while (orient2d(points[l], points[r], points[hullPrev[l]]) < 0) {
+            l = hullPrev[l];
+            moved = true;
+        }
+        while (orient2d(points[l], points[r], points[hullNext[r]]) < 0) {
+            r = hullNext[r];
+            moved = true;
+        }
+    }
+
+    int l0 = l, r0 = r;
+    int pending = -1; // The half-edge r -> l of the last triangle, or -1 below the lower tangent.
+    int bottom = -1;  // The half-edge l0 -> r0; l0 keeps its old boundary edge until the zip is done.
+    for (;;) {
+        int lc = hullNext[l], rc = hullPrev[r];
+        bool leftAbove = orient2d(points[l], points[r], points[lc]) > 0;
+        bool rightAbove = orient2d(points[l], points[r], points[rc]) > 0;
+        if (!leftAbove && !rightAbove) {
+            break; // (l, r) is the upper tangent.
+        }
+
+        bool takeLeft = !rightAbove;
+        if (leftAbove && rightAbove) {
+            // Quadrilateral l, r, rc, lc: a diagonal is usable if it separates the other two corners.
+            bool leftDiagonal = orient2d(points[r], points[lc], points[rc]) < 0;
+            bool rightDiagonal = orient2d(points[l], points[rc], points[lc]) > 0;
+            takeLeft = !rightDiagonal || (leftDiagonal && incircle(points[l], points[r], points[lc], points[rc]) <= 0);
+        }
+
+        int e = t.triangles.size();
+        int closed = takeLeft ? boundaryOut[l] : boundaryOut[rc];
+        int top = takeLeft ? lc : rc;
+        t.triangles.insert(t.triangles.end(), {l, r, top});
+        t.halfedges.insert(t.halfedges.end(), {pending, takeLeft ? -1 : closed, takeLeft ? closed : -1});
+        if (pending != -1) {
+            t.halfedges[pending] = e;
+        } else {
+            bottom = e;
+        }
+        t.halfedges[closed] = takeLeft ? e + 2 : e + 1;
+        seam.insert(seam.end(), {e, e + 1, e + 2});
+
+        if (takeLeft) {
+            pending = e + 1;
+            l = lc;
+        } else {
+            pending = e + 2;
+            r = rc;
+        }
+    }
+
+    boundaryOut[l0] = bottom;
+    boundaryOut[r] = pending;
+    hullNext[l0] = r0;
+    hullPrev[r0] = l0;
+    hullNext[r] = l;
+    hullPrev[l] = r;
+}
+
+/**
+ * @brief Delaunay triangulation of a set of points.
+ *
+ * Uses the same orient2d and incircle predicates as the hull engine, so the triangulation
+ * boundary matches the quickHull output (up to collinear boundary points, which quickHull drops).
+ *
+ * With several threads the points are split into vertical strips of lexicographically
+ * consecutive points, every strip is triangulated on its own thread, neighbouring strips are
+ * zipped together along their common tangents, and Lawson flips from the seams restore the
+ * Delaunay property. Small inputs, and inputs with a strip of collinear points, are triangulated
+ * by a single DelaunayBuilder.
+ *
+ * @param points The set of points.
+ * @param threads The number of worker threads.
+ * @param minStripSize The smallest number of points worth a strip of its own.
+ * @return The triangulation in half-edge form.
+ */
+Triangulation delaunay(const vector<Point>& points, int threads = 1, int minStripSize = 4096) {
+    int n = points.size();
+    int strips = min(threads, n / max(3, minStripSize));
+    if (strips < 2) {
+        return DelaunayBuilder(points).build();
+    }
+
+    // Strip boundaries by selection; points equal to a boundary point stay in its strip.
+    auto less = [&](int i, int j) { return lexicographicLess(points[i], points[j]); };
+    vector<int> order(n);
+    for (int i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    vector<int> bounds = {0};
+    for (int s = 1; s < strips; s++) {
+        int m = max(bounds.back(), (int)((long long)n * s / strips));
+        if (m >= n) {
+            break;
         }
+        nth_element(order.begin() + bounds.back(), order.begin() + m, order.end(), less);
+        Point pivot = points[order[m]];
+        m = partition(order.begin() + m, order.end(), [&](int i) { return !lexicographicLess(pivot, points[i]); }) -
+            order.begin();
+        bounds.push_back(m);
     }
+    if (bounds.back() != n) {
+        bounds.push_back(n);
+    }
+    strips = bounds.size() - 1;
 
-    swap(points[referentialIndex], points[right]);
+    vector<Triangulation> parts(strips);
+    parallelChunks(strips, 1, threads, [&](int begin, int end) {
+        for (int s = begin; s < end; s++) {
+            vector<Point> local(bounds[s + 1] - bounds[s]);
+            for (int k = bounds[s]; k < bounds[s + 1]; k++) {
+                local[k - bounds[s]] = points[order[k]];
+            }
+            parts[s] = DelaunayBuilder(local).build();
+            for (int& v : parts[s].triangles) {
+                v = order[bounds[s] + v];
+            }
+            for (int& v : parts[s].hull) {
+                v = order[bounds[s] + v];
+            }
+        }
+    });
 
-    int splitIndex = left;
-    // Partition points into two sets based on their x-coordinates relative to the referential point.
-    for (int i = left; i < right; i++) {
-        if (points[i].x < points[right].x) {
-            swap(points[i], points[splitIndex]);
-            splitIndex++;
+    Triangulation result;
+    vector<int> hullNext(n, -1), hullPrev(n, -1), boundaryOut(n, -1), lowest(strips), highest(strips);
+    for (int s = 0; s < strips; s++) {
+        const Triangulation& part = parts[s];
+        if (part.hull.empty()) {
+            return DelaunayBuilder(points).build(); // A strip of collinear points has no triangles to zip.
+        }
+        int offset = result.triangles.size();
+        result.triangles.insert(result.triangles.end(), part.triangles.begin(), part.triangles.end());
+        for (int e : part.halfedges) {
+            result.halfedges.push_back(e == -1 ? -1 : e + offset);
+        }
+        for (size_t e = 0; e < part.halfedges.size(); e++) {
+            if (part.halfedges[e] == -1) {
+                boundaryOut[part.triangles[e]] = e + offset;
+            }
         }
+        int m = part.hull.size();
+        lowest[s] = highest[s] = part.hull[0];
+        for (int k = 0; k < m; k++) {
+            int v = part.hull[k];
+            hullNext[v] = part.hull[(k + 1) % m];
+            hullPrev[v] = part.hull[(k + m - 1) % m];
+            lowest[s] = less(v, lowest[s]) ? v : lowest[s];
+            highest[s] = less(highest[s], v) ? v : highest[s];
+        }
+    }
+
+    vector<int> seam;
+    for (int s = 0; s + 1 < strips; s++) {
+        zipTriangulations(points, result, hullNext, hullPrev, boundaryOut, highest[s], lowest[s + 1], seam);
     }
+    lawsonFlips(points, result, boundaryOut, seam);
 
-    // Swap the referential point to its correct position.
-    swap(points[right], points[splitIndex]);
+    int e = lowest[0];
+    do {
+        result.hull.push_back(e);
+        e = hullNext[e];
+    } while (e != lowest[0]);
+    return result;
+}
 
-    // Add the referential point to the convex hull. c
-    convexHull.push_back(points[splitIndex]);
+/**
+ * @brief Check that the triangulation boundary equals the quickHull output.
+ *
+ * @param points The set of points.
+ * @param triangulation The triangulation of the points.
+ * @return True if both list the same vertices in the same cyclic order.
+ */
+bool boundaryMatchesHull(const vector<Point>& points, const Triangulation& triangulation) {
+    const vector<int>& boundary = triangulation.hull;
+    vector<int> corners;
+    int m = boundary.size();
+    for (int k = 0; k < m; k++) {
+        Point prev = points[boundary[(k + m - 1) % m]], next = points[boundary[(k + 1) % m]];
+        if (orient2d(prev, points[boundary[k]], next) != 0) {
+            corners.push_back(boundary[k]);
+        }
+    }
 
-    // Find the point with the maximum distance from the line segment between left and the referential point.
-    int maxDistancePoint = findMaxDistancePoint(points, left, splitIndex);
+    vector<int> candidates, hull;
+    for (int i = 0; i < (int)points.size(); i++) {
+        candidates.push_back(i);
+    }
+    quickHullIndices(points, candidates, hull);
 
-    // Recursively apply QuickHull to the left and right subproblems.
-    quickHull(points, left, splitIndex - 1, convexHull);
-    quickHull(points, splitIndex + 1, right, convexHull);
+    if (corners.size() != hull.size()) {
+        return false;
+    }
+    auto sameAsHullStart = [&](int i) {
+        return points[i].x == points[hull[0]].x && points[i].y == points[hull[0]].y;
+    };
+    auto offset = find_if(corners.begin(), corners.end(), sameAsHullStart);
+    if (offset == corners.end()) {
+        return false;
+    }
+    rotate(corners.begin(), offset, corners.end());
+    for (size_t k = 0; k < hull.size(); k++) {
+        Point a = points[corners[k]], b = points[hull[k]];
+        if (a.x != b.x || a.y != b.y) {
+            return false;
+        }
+    }
+    return true;
 }
 
 /**
- * @brief The main function for the QuickHull convex hull algorithm.
+ * @brief Find what is wrong with a triangulation, if anything.
  *
- * This function reads a set of 2D points from the user, calculates the convex hull
- * of the points, and prints the points forming the convex hull.
+ * @param points The set of points.
+ * @param t The triangulation of the points.
+ * @return Nullptr if the half-edges are consistent, every triangle is counter-clockwise, every
+ *         distinct point is a vertex, the boundary equals the convex hull and every interior edge
+ *         is locally Delaunay; otherwise a description of the first problem found.
+ */
+const char* triangulationProblem(const vector<Point>& points, const Triangulation& t) {
+    vector<Point> used, distinct = points;
+    for (size_t e = 0; e < t.triangles.size(); e++) {
+        int opposite = t.halfedges[e];
+        if (opposite != -1 && (t.halfedges[opposite] != (int)e || t.triangles[opposite] != t.triangles[nextHalfedge(e)])) {
+            return "inconsistent half-edges";
+        }
+        if (e % 3 == 0 && !(orient2d(points[t.triangles[e]], points[t.triangles[e + 1]], points[t.triangles[e + 2]]) > 0)) {
+            return "a triangle is not counter-clockwise";
+        }
+        used.push_back(points[t.triangles[e]]);
+    }
+    auto same = [](Point a, Point b) { return a.x == b.x && a.y == b.y; };
+    for (vector<Point>* set : {&used, &distinct}) {
+        sort(set->begin(), set->end(), lexicographicLess);
+        set->erase(unique(set->begin(), set->end(), same), set->end());
+    }
+    if (used.size() != distinct.size()) {
+        return "a point is missing";
+    }
+    if (!boundaryMatchesHull(points, t)) {
+        return "boundary differs from convex hull";
+    }
+    for (size_t e = 0; e < t.halfedges.size(); e++) {
+        int opposite = t.halfedges[e];
+        if (opposite == -1) {
+            continue;
+        }
+        Point a = points[t.triangles[e]], b = points[t.triangles[nextHalfedge(e)]];
+        Point c = points[t.triangles[prevHalfedge(e)]], d = points[t.triangles[prevHalfedge(opposite)]];
+        if (incircle(a, b, c, d) > 0) {
+            return "an edge is not locally Delaunay";
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Self-check of the Delaunay engine on random point sets, and a benchmark of the strips.
+ *
+ * Every set is triangulated by a single builder and in 2 to 8 strips, and both results must pass
+ * triangulationProblem. Then a large random set is timed on one thread and on several.
+ *
+ * @param rounds The number of random point sets to check.
+ * @param threads The number of threads of the benchmark.
+ * @return True if every check passed.
+ */
+bool checkDelaunay(int rounds, int threads) {
+    srand(12345);
+    for (int round = 0; round < rounds; round++) {
+        int n = 3 + rand() % 400;
+        vector<Point> points;
+        for (int i = 0; i < n; i++) {
+            // Every other round draws from a 20 x 20 or 20 x 2 grid, so duplicates and long
+            // collinear runs occur in every such set.
+            double x = rand() % 1000, y = rand() % 1000;
+            int rows = round % 4 == 1 ? 20 : 2;
+            points.push_back(round % 2 ? Point{(double)(rand() % 20), (double)(rand() % rows)} : Point{x + rand() / (double)RAND_MAX, y});
+        }
+
+        int strips = 2 + round % 7;
+        for (int split : {1, strips}) {
+            Triangulation t = delaunay(points, split, 8);
+            const char* problem = triangulationProblem(points, t);
+            if (problem) {
+                cout << "Round " << round << ", " << n << " points in " << split << " strips: " << problem << endl;
+                return false;
+            }
+        }
+    }
+
+    vector<Point> points;
+    for (int i = 0; i < 1000000; i++) {
+        points.push_back({rand() / (double)RAND_MAX, rand() / (double)RAND_MAX});
+    }
+    auto start = chrono::steady_clock::now();
+    Triangulation serial = delaunay(points, 1);
+    auto middle = chrono::steady_clock::now();
+    Triangulation parallel = delaunay(points, threads);
+    auto end = chrono::steady_clock::now();
+    cout << points.size() << " points, " << serial.triangles.size() / 3 << " triangles: 1 thread "
+         << chrono::duration<double, milli>(middle - start).count() << " ms, " << threads << " threads "
+         << chrono::duration<double, milli>(end - middle).count() << " ms" << endl;
+    if (parallel.triangles.size() != serial.triangles.size() || triangulationProblem(points, parallel)) {
+        cout << "The strip triangulation of the benchmark set is wrong" << endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Read a set of points from standard input.
+ *
+ * @param label The coordinate names shown in the prompt.
+ * @return The points entered by the user.
  */
-int main() {
+vector<Point> readPoints(const char* label) {
     int n;
     cout << "Enter the number of points: ";
     cin >> n;
@@ -108,11 +2839,167 @@ int main() {
 
     for (int i = 0; i < n; i++) {
         Point point;
-        cout << "Enter coordinates for point " << i + 1 << " (x y): ";
+        cout << "Enter coordinates for point " << i + 1 << " (" << label << "): ";
         cin >> point.x >> point.y;
         points.push_back(point);
     }
 
+    return points;
+}
+
+/**
+ * @brief The main function for the QuickHull convex hull algorithm.
+ *
+ * This function reads a set of 2D points from the user, calculates the convex hull
+ * of the points, and prints the points forming the convex hull.
+ *
+ * Modes:
+ * - no arguments: planar hull of (x y) points;
+ * - --spherical: hull of (lon lat) points in degrees on the sphere;
+ * - --delaunay: Delaunay triangulation of (x y) points;
+ * - --check-hull [rounds]: self-check of the planar hull on collinear and duplicate points;
+ * - --check-delaunay [rounds] [threads]: self-check of the Delaunay engine on random point sets and a benchmark;
+ * - --simplify k [--enclosing]: hull of (x y) points reduced to at most k vertices;
+ * - --check-simplify [rounds] [threads]: self-check of hull simplification and a batch benchmark;
+ * - --check-locate [hulls] [queries] [threads]: self-check and benchmark of the which-hull-contains-point index;
+ * - --halfplanes: intersection of (a b c) half-planes a * x + b * y <= c;
+ * - --check-halfplanes [sets] [size] [threads]: self-check of half-plane intersection against a simplex baseline;
+ * - --auto: planar hull of (x y) points by the engine predicted to be fastest, with its statistics;
+ * - --check-engines [points]: benchmark of every hull engine against the auto mode's predictions, on fitted and held-out classes.
+ */
+int main(int argc, char* argv[]) {
+    if (argc > 1 && strcmp(argv[1], "--spherical") == 0) {
+        vector<Point> points = readPoints("lon lat");
+        vector<int> hull;
+        vector<Face3> faces;
+
+        if (sphericalHull(points, hull, faces)) {
+            cout << "Points forming the spherical convex hull:" << endl;
+            for (int i : hull) {
+                cout << "(" << points[i].x << ", " << points[i].y << ")" << endl;
+            }
+        } else {
+            cout << "Points do not fit in a hemisphere, 3D hull faces:" << endl;
+            for (const Face3& f : faces) {
+                cout << f.a + 1 << " " << f.b + 1 << " " << f.c + 1 << endl;
+            }
+        }
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--delaunay") == 0) {
+        vector<Point> points = readPoints("x y");
+        Triangulation t = delaunay(points, max(1u, thread::hardware_concurrency()));
+
+        cout << "Delaunay triangles:" << endl;
+        for (size_t k = 0; k < t.triangles.size(); k += 3) {
+            cout << t.triangles[k] + 1 << " " << t.triangles[k + 1] + 1 << " " << t.triangles[k + 2] + 1 << endl;
+        }
+        bool matches = boundaryMatchesHull(points, t);
+        cout << "Boundary matches convex hull: " << (matches ? "yes" : "no") << endl;
+        return matches ? 0 : 1;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--check-hull") == 0) {
+        bool passed = checkQuickHull(argc > 2 ? atoi(argv[2]) : 2000);
+        cout << "Hull self-check " << (passed ? "passed" : "failed") << endl;
+        return passed ? 0 : 1;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--check-delaunay") == 0) {
+        int threads = argc > 3 ? atoi(argv[3]) : max(1u, thread::hardware_concurrency());
+        bool passed = checkDelaunay(argc > 2 ? atoi(argv[2]) : 2000, threads);
+        cout << "Delaunay self-check " << (passed ? "passed" : "failed") << endl;
+        return passed ? 0 : 1;
+    }
+
+    if (argc > 2 && strcmp(argv[1], "--simplify") == 0) {
+        int k = atoi(argv[2]);
+        bool enclosing = argc > 3 && strcmp(argv[3], "--enclosing") == 0;
+        vector<Point> points = readPoints("x y");
+        vector<Point> hull;
+        quickHull(points, 0, (int)points.size() - 1, hull);
+
+        double change;
+        vector<Point> simple = simplifyHull(hull, k, enclosing, &change);
+        cout << "Simplified convex hull (" << hull.size() << " to " << simple.size() << " vertices, area "
+             << (enclosing ? "added" : "lost") << " " << change << "):" << endl;
+        for (const Point& p : simple) {
+            cout << "(" << p.x << ", " << p.y << ")" << endl;
+        }
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--check-simplify") == 0) {
+        int threads = argc > 3 ? atoi(argv[3]) : max(1u, thread::hardware_concurrency());
+        bool passed = checkSimplify(argc > 2 ? atoi(argv[2]) : 500, threads);
+        cout << "Simplification self-check " << (passed ? "passed" : "failed") << endl;
+        return passed ? 0 : 1;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--check-locate") == 0) {
+        int threads = argc > 4 ? atoi(argv[4]) : max(1u, thread::hardware_concurrency());
+        bool passed = checkHullIndex(argc > 2 ? atoi(argv[2]) : 200000, argc > 3 ? atoi(argv[3]) : 1000000, threads);
+        cout << "Hull index self-check " << (passed ? "passed" : "failed") << endl;
+        return passed ? 0 : 1;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--halfplanes") == 0) {
+        int n;
+        cout << "Enter the number of half-planes: ";
+        cin >> n;
+        vector<HalfPlane> planes(n);
+        for (int i = 0; i < n; i++) {
+            cout << "Enter half-plane " << i + 1 << " (a b c for a*x + b*y <= c): ";
+            cin >> planes[i].a >> planes[i].b >> planes[i].c;
+        }
+
+        vector<Point> polygon;
+        Feasibility outcome = intersectHalfPlanes(planes, polygon);
+        if (outcome == Feasibility::Empty) {
+            cout << "The intersection is empty" << endl;
+            return 1;
+        }
+        if (outcome == Feasibility::Unbounded && polygon.empty()) {
+            cout << "The intersection is unbounded and lies entirely outside the display box" << endl;
+            return 0;
+        }
+        cout << (outcome == Feasibility::Bounded ? "Vertices of the intersection:" : "The intersection is unbounded, clipped vertices:") << endl;
+        for (const Point& p : polygon) {
+            cout << "(" << p.x << ", " << p.y << ")" << endl;
+        }
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--check-halfplanes") == 0) {
+        int threads = argc > 4 ? atoi(argv[4]) : max(1u, thread::hardware_concurrency());
+        bool passed = checkHalfPlanes(argc > 2 ? atoi(argv[2]) : 100000, argc > 3 ? atoi(argv[3]) : 16, threads);
+        cout << "Half-plane self-check " << (passed ? "passed" : "failed") << endl;
+        return passed ? 0 : 1;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--auto") == 0) {
+        vector<Point> points = readPoints("x y");
+        vector<int> hull;
+        HullStats stats = autoHull(points, hull);
+
+        cout << "Points forming the convex hull:" << endl;
+        for (int i : hull) {
+            cout << "(" << points[i].x << ", " << points[i].y << ")" << endl;
+        }
+        printHullStats(stats);
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--check-engines") == 0) {
+        bool passed = checkHullEngines(argc > 2 ? atoi(argv[2]) : 1000000);
+        cout << "Hull engine check " << (passed ? "passed" : "failed") << endl;
+        return passed ? 0 : 1;
+    }
+
+    vector<Point> points = readPoints("x y");
+    int n = points.size();
+
     vector<Point> convexHull;
     quickHull(points, 0, n - 1, convexHull);
 